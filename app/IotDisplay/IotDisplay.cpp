@@ -14,11 +14,27 @@
 
 #include <Adafruit_GFX.h>;
 #include <MCUFRIEND_kbv.h>;
+#include "DisplayProtocol.h"
 #if USE_FONTS == 1
   #include <Fonts/FreeSansBold9pt7b.h>
   #include <Fonts/FreeSansBold24pt7b.h>
 #endif
 
+// Largest LED Grid kept in the cell model (4 bits per LED plus a dirty bit) and the number of different LED colors
+#define GRID_MAX_COLUMNS 24
+#define GRID_MAX_ROWS 16
+#define GRID_CELLS (GRID_MAX_COLUMNS * GRID_MAX_ROWS)
+#define GRID_PALETTE_SIZE 16
+
+// Pixels sent to the LCD Display per push when repainting LED's
+#define GRID_PUSH_SIZE 32
+
+// Number of sensor data points kept for the chart (one column each), height of the label above each chart, and the smallest value range of a chart in hundredths (keeps sensor noise from filling the chart)
+#define CHART_POINTS 48
+#define CHART_SERIES 3
+#define CHART_LABEL_HEIGHT 10
+#define CHART_MIN_SPAN 20
+
 int LED_SIZE = 0;
 int LED_BORDER = 0;
 bool IS_LANDSCAPE = true;
@@ -26,6 +42,33 @@ bool IS_LANDSCAPE = true;
 MCUFRIEND_kbv tft;
 int screenWidth, screenHeight;
 
+// LED Grid model: palette index of every LED (2 per byte), LED's that changed since they were drawn, and the LED colors (index 0 is the background)
+uint8_t gridCells[(GRID_CELLS + 1) / 2];
+uint8_t gridDirty[(GRID_CELLS + 7) / 8];
+uint16_t gridPalette[GRID_PALETTE_SIZE];
+uint8_t gridPaletteCount = 1;
+
+// Sensor data history drawn as one chart per series (the newest point overwrites the oldest and the column after it is left blank)
+typedef struct
+{
+  char name[16];
+  uint16_t color;
+} chart_series;
+const chart_series chartSeries[CHART_SERIES] PROGMEM =
+{
+  { "Temperature F", TFT_PURPLE },
+  { "Pressure inHg", TFT_WHITE },
+  { "Humidity %", TFT_YELLOW },
+};
+int16_t chartValues[CHART_SERIES][CHART_POINTS];
+int16_t chartLow[CHART_SERIES], chartHigh[CHART_SERIES];
+uint8_t chartCount = 0;
+uint8_t chartNext = 0;
+uint32_t chartTimestamp = 0;
+uint8_t currentView = DISPLAY_VIEW_LEDS;
+
+void drawChart(uint8_t series);
+
 /**
  * NAME: initializeDisplay()
  * DESCRIPTION: Initialize the LCD Display.
@@ -53,12 +96,15 @@ void initializeDisplay(int ledSize, int ledBorder, bool landscape)
   IS_LANDSCAPE = landscape;
   screenWidth = tft.width();
   screenHeight = tft.height();
+  gridPalette[0] = TFT_BLACK;
 }
 
 /**
  * NAME: cleareDisplay()
  * DESCRIPTION: Clear the LCD Display.
  * PROCESS:       Fills the screen with black pixels
+ *                Sets every LED in the Grid model to the background (nothing is left to repaint)
+ *                Draws the charts again if they are the current view
  * INPUTS: 
  *      None
  * OUTPUTS: 
@@ -69,12 +115,19 @@ void clearDisplay()
 {
   // Clear Display by filling with black
   tft.fillScreen(TFT_BLACK);
+  memset(gridCells, 0, sizeof(gridCells));
+  memset(gridDirty, 0, sizeof(gridDirty));
+  if(currentView == DISPLAY_VIEW_CHART)
+  {
+    for(uint8_t series = 0;series < CHART_SERIES;++series)
+      drawChart(series);
+  }
 }
 
 /**
  * NAME: getNumberLEDColumns()
  * DESCRIPTION: Calculated the number LED Columns give the LED Size and Screen Size.
- * PROCESS:       Calulation screenWidth/LED_SIZE
+ * PROCESS:       Calulation screenWidth/LED_SIZE (limited to GRID_MAX_COLUMNS)
  * INPUTS: 
  *      None
  * OUTPUTS: 
@@ -84,13 +137,13 @@ void clearDisplay()
 int getNumberLEDColumns()
 {
   // Return number of Columns in the Display Grid
-  return screenWidth/LED_SIZE;
+  return min(screenWidth/LED_SIZE, GRID_MAX_COLUMNS);
 }
 
 /**
  * NAME: getNumberLEDRows()
  * DESCRIPTION: Calculated the number LED Rows give the LED Size and Screen Size.
- * PROCESS:       Calulation screenHeight/LED_SIZE
+ * PROCESS:       Calulation screenHeight/LED_SIZE (limited to GRID_MAX_ROWS)
  * INPUTS: 
  *      None
  * OUTPUTS: 
@@ -100,7 +153,7 @@ int getNumberLEDColumns()
 int getNumberLEDRows()
 {
   // Return number of Rows in the Display Grid
-  return screenHeight/LED_SIZE;
+  return min(screenHeight/LED_SIZE, GRID_MAX_ROWS);
 }
 
 /**
@@ -179,7 +232,7 @@ void displayWelcomeMessage(String msg1, String msg2)
  *      None
  * 
  */
-void displayMessage(int row, int column, String msg, int fontSize, int color)
+void displayMessage(int row, int column, const char *msg, int fontSize, int color)
 {
   int x1, y1, w, h;
 
@@ -190,11 +243,141 @@ void displayMessage(int row, int column, String msg, int fontSize, int color)
   tft.print(msg); 
 }
 
+/**
+ * NAME: getGridCell()
+ * DESCRIPTION: Gets the palette index of a LED in the Grid model.
+ * INPUTS: 
+ *      i  Index of the LED (y * GRID_MAX_COLUMNS + x)
+ * OUTPUTS: 
+ *      Palette index
+ * 
+ */
+uint8_t getGridCell(int i)
+{
+  return (i & 1) ? gridCells[i / 2] >> 4 : gridCells[i / 2] & 0x0F;
+}
+
+/**
+ * NAME: setGridCell()
+ * DESCRIPTION: Sets the palette index of a LED in the Grid model and marks it for repainting if it changed.
+ * INPUTS: 
+ *      i  Index of the LED (y * GRID_MAX_COLUMNS + x)
+ *      index  Palette index
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void setGridCell(int i, uint8_t index)
+{
+  if(getGridCell(i) == index)
+    return;
+  if(i & 1)
+    gridCells[i / 2] = (gridCells[i / 2] & 0x0F) | (index << 4);
+  else
+    gridCells[i / 2] = (gridCells[i / 2] & 0xF0) | index;
+  gridDirty[i / 8] |= 1 << (i % 8);
+}
+
+/**
+ * NAME: isGridCellDirty()
+ * DESCRIPTION: Checks if a LED changed since it was drawn.
+ * INPUTS: 
+ *      i  Index of the LED (y * GRID_MAX_COLUMNS + x)
+ * OUTPUTS: 
+ *      True if the LED has to be repainted
+ * 
+ */
+bool isGridCellDirty(int i)
+{
+  return gridDirty[i / 8] & (1 << (i % 8));
+}
+
+/**
+ * NAME: getPaletteIndex()
+ * DESCRIPTION: Gets the palette index of a LED color, adding the color to the palette if it is new.
+ * PROCESS:       A new color when the palette is full replaces the last color (its LED's are repainted)
+ * INPUTS: 
+ *      color The color for the LED
+ * OUTPUTS: 
+ *      Palette index
+ * 
+ */
+uint8_t getPaletteIndex(uint16_t color)
+{
+  for(uint8_t i = 0;i < gridPaletteCount;++i)
+  {
+    if(gridPalette[i] == color)
+      return i;
+  }
+  if(gridPaletteCount < GRID_PALETTE_SIZE)
+  {
+    gridPalette[gridPaletteCount] = color;
+    return gridPaletteCount++;
+  }
+  gridPalette[GRID_PALETTE_SIZE - 1] = color;
+  for(int i = 0;i < GRID_CELLS;++i)
+  {
+    if(getGridCell(i) == GRID_PALETTE_SIZE - 1)
+      gridDirty[i / 8] |= 1 << (i % 8);
+  }
+  return GRID_PALETTE_SIZE - 1;
+}
+
+/**
+ * NAME: drawGridRun()
+ * DESCRIPTION: Draws adjacent LED's of a row (including their borders) with one address window.
+ * PROCESS:       Set the address window to the LED's
+ *                Push every line of pixels (background for the border and the LED color for the rest) in blocks of GRID_PUSH_SIZE
+ *                Clear the changed flags of the LED's
+ * INPUTS: 
+ *      x0  First LED in the row
+ *      x1  Last LED in the row
+ *      y   Row of the LED's
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void drawGridRun(int x0, int x1, int y)
+{
+  uint16_t pixels[GRID_PUSH_SIZE];
+  uint8_t count = 0;
+  bool first = true;
+
+  tft.setAddrWindow(x0 * LED_SIZE, y * LED_SIZE, (x1 + 1) * LED_SIZE - 1, (y + 1) * LED_SIZE - 1);
+  for(int line = 0;line < LED_SIZE;++line)
+  {
+    for(int x = x0;x <= x1;++x)
+    {
+      uint16_t color = line < LED_BORDER ? gridPalette[0] : gridPalette[getGridCell(y * GRID_MAX_COLUMNS + x)];
+      for(int i = 0;i < LED_SIZE;++i)
+      {
+        pixels[count++] = i < LED_BORDER ? gridPalette[0] : color;
+        if(count == GRID_PUSH_SIZE)
+        {
+          tft.pushColors(pixels, count, first);
+          first = false;
+          count = 0;
+        }
+      }
+    }
+  }
+  if(count != 0)
+    tft.pushColors(pixels, count, first);
+  tft.setAddrWindow(0, 0, screenWidth - 1, screenHeight - 1);
+
+  // LED's are now up to date
+  for(int x = x0;x <= x1;++x)
+  {
+    int i = y * GRID_MAX_COLUMNS + x;
+    gridDirty[i / 8] &= ~(1 << (i % 8));
+  }
+}
+
 /**
  * NAME: displayLED()
- * DESCRIPTION: Displays a LED on the screen at a location, and color.
- * PROCESS:       If x and y are 0 then clear the display
- *                Draw a rectangle on the screen in the specified Color and Location (using the calculated LED Size)
+ * DESCRIPTION: Sets a LED in the Grid model to a color, it is drawn by the next call to updateDisplay().
+ * PROCESS:       If x is 0 then set the whole row to the background (the Grid wraps by overwriting its oldest row instead of clearing the screen)
+ *                Set the LED to the palette index of the color (only marked for repainting if it changed)
  * INPUTS: 
  *      x  Row location for the LED
  *      y  Column location for the LED
@@ -205,10 +388,240 @@ void displayMessage(int row, int column, String msg, int fontSize, int color)
  */
 void displayLED(int x, int y, int color)
 {
-  // Clear the Display if at the top of the Grid
-  if(x == 0 && y == 0)
-    clearDisplay();
+  if(x < 0 || x >= getNumberLEDColumns() || y < 0 || y >= getNumberLEDRows())
+    return;
+
+  // Overwrite the oldest row when starting a new row
+  if(x == 0)
+  {
+    for(int i = 1;i < getNumberLEDColumns();++i)
+      setGridCell(y * GRID_MAX_COLUMNS + i, 0);
+  }
+
+  // Update the LED
+  setGridCell(y * GRID_MAX_COLUMNS + x, getPaletteIndex(color));
+}
+
+/**
+ * NAME: updateDisplay()
+ * DESCRIPTION: Draws the LED's that changed since the last update (nothing is drawn while the charts are shown).
+ * PROCESS:       Find each run of adjacent changed LED's in a row
+ *                Draw the run with a single address window and pixel push
+ * INPUTS: 
+ *      None
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void updateDisplay()
+{
+  if(currentView != DISPLAY_VIEW_LEDS)
+    return;
+  int columns = getNumberLEDColumns();
+  int rows = getNumberLEDRows();
+  for(int y = 0;y < rows;++y)
+  {
+    for(int x = 0;x < columns;++x)
+    {
+      if(!isGridCellDirty(y * GRID_MAX_COLUMNS + x))
+        continue;
+      int end = x;
+      while(end + 1 < columns && isGridCellDirty(y * GRID_MAX_COLUMNS + end + 1))
+        ++end;
+      drawGridRun(x, end, y);
+      x = end;
+    }
+  }
+}
+
+/**
+ * NAME: isChartPoint()
+ * DESCRIPTION: Checks if a slot of the history holds a point that is drawn.
+ * INPUTS: 
+ *      slot  Position in the history
+ * OUTPUTS: 
+ *      True if the slot has a point and is not the blank slot after the newest point
+ * 
+ */
+bool isChartPoint(uint8_t slot)
+{
+  return slot < chartCount && !(chartCount == CHART_POINTS && slot == chartNext);
+}
+
+/**
+ * NAME: drawChartColumn()
+ * DESCRIPTION: Draws the column of one point of a chart with fast line primitives.
+ * PROCESS:       Blank the column
+ *                If the slot holds a point (the slot after the newest point is left blank) then draw a vertical line from the
+ *                previous point and a horizontal line at the value of the point
+ * INPUTS: 
+ *      series  0 for temperature, 1 for pressure, and 2 for humidity
+ *      slot  Position of the point in the history (and column of the chart)
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void drawChartColumn(uint8_t series, uint8_t slot)
+{
+  int width = screenWidth / CHART_POINTS;
+  int top = series * (screenHeight / CHART_SERIES) + CHART_LABEL_HEIGHT;
+  int height = screenHeight / CHART_SERIES - CHART_LABEL_HEIGHT - 2;
+  int x = slot * width;
+  tft.fillRect(x, top, width, height, TFT_BLACK);
+  if(!isChartPoint(slot))
+    return;
+
+  // Map the value to the chart (the low value at the bottom)
+  long span = (long)chartHigh[series] - chartLow[series];
+  int y = top + height - 1 - ((long)chartValues[series][slot] - chartLow[series]) * (height - 1) / span;
+  uint16_t color = pgm_read_word(&chartSeries[series].color);
+  if(slot > 0 && isChartPoint(slot - 1))
+  {
+    int previous = top + height - 1 - ((long)chartValues[series][slot - 1] - chartLow[series]) * (height - 1) / span;
+    tft.drawFastVLine(x, min(y, previous), abs(y - previous) + 1, color);
+  }
+  tft.drawFastHLine(x, y, width, color);
+}
+
+/**
+ * NAME: drawChartLabel()
+ * DESCRIPTION: Draws the name and newest value of a chart (and the time of the newest point above the first chart).
+ * INPUTS: 
+ *      series  0 for temperature, 1 for pressure, and 2 for humidity
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void drawChartLabel(uint8_t series)
+{
+  char label[40];
+  int top = series * (screenHeight / CHART_SERIES);
+  int length = 0;
+  strcpy_P(label, chartSeries[series].name);
+  length = strlen(label);
+  if(chartCount != 0)
+  {
+    int16_t value = chartValues[series][(chartNext + CHART_POINTS - 1) % CHART_POINTS];
+    length += snprintf_P(label + length, sizeof(label) - length, PSTR("  %s%d.%02d"), value < 0 ? "-" : "", abs(value) / 100, abs(value) % 100);
+  }
+  if(series == 0 && chartTimestamp != 0)
+    snprintf_P(label + length, sizeof(label) - length, PSTR("  %02d:%02d UTC"), (int)((chartTimestamp / 3600) % 24), (int)((chartTimestamp / 60) % 60));
+  tft.fillRect(0, top, screenWidth, CHART_LABEL_HEIGHT, TFT_BLACK);
+  tft.setCursor(0, top + 1);
+  tft.setTextSize(1);
+  tft.setTextColor(pgm_read_word(&chartSeries[series].color));
+  tft.print(label);
+}
+
+/**
+ * NAME: drawChart()
+ * DESCRIPTION: Draws the chart of a series of the sensor data history.
+ * PROCESS:       Clear the chart area and draw the label
+ *                Draw every column
+ * INPUTS: 
+ *      series  0 for temperature, 1 for pressure, and 2 for humidity
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void drawChart(uint8_t series)
+{
+  int height = screenHeight / CHART_SERIES;
+  tft.fillRect(0, series * height, screenWidth, height, TFT_BLACK);
+  drawChartLabel(series);
+  for(uint8_t slot = 0;slot < chartCount;++slot)
+    drawChartColumn(series, slot);
+}
+
+/**
+ * NAME: setDisplayView()
+ * DESCRIPTION: Shows the LED Grid or the sensor data charts.
+ * PROCESS:       Clear the screen
+ *                Mark every LED that is not the background for repainting or draw the charts
+ * INPUTS: 
+ *      view  DISPLAY_VIEW_LEDS or DISPLAY_VIEW_CHART
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void setDisplayView(uint8_t view)
+{
+  if(view == currentView)
+    return;
+  currentView = view;
+  tft.fillScreen(TFT_BLACK);
+  if(view == DISPLAY_VIEW_CHART)
+  {
+    for(uint8_t series = 0;series < CHART_SERIES;++series)
+      drawChart(series);
+  }
+  else
+  {
+    for(int i = 0;i < GRID_CELLS;++i)
+    {
+      if(getGridCell(i) != 0)
+        gridDirty[i / 8] |= 1 << (i % 8);
+    }
+  }
+}
+
+/**
+ * NAME: addChartPoint()
+ * DESCRIPTION: Adds a sensor data point to the history and draws it.
+ * PROCESS:       Store the point in place of the oldest point
+ *                Widen the range of a chart that the point does not fit in and redraw that chart
+ *                Otherwise only draw the new column and blank the column after it (it holds the oldest point)
+ *                Update the labels with the newest values
+ * INPUTS: 
+ *      timestamp  Epoch seconds when the sample was taken (0 if unknown)
+ *      temperature  Hundredths of a degree F
+ *      pressure  Hundredths of an inHg
+ *      humidity  Hundredths of a %
+ * OUTPUTS: 
+ *      None
+ * 
+ */
+void addChartPoint(uint32_t timestamp, int16_t temperature, uint16_t pressure, uint16_t humidity)
+{
+  int16_t values[CHART_SERIES] = { temperature, (int16_t)pressure, (int16_t)humidity };
+  uint8_t slot = chartNext;
+  if(chartCount < CHART_POINTS)
+    ++chartCount;
+  chartNext = (chartNext + 1) % CHART_POINTS;
+  if(timestamp != 0)
+    chartTimestamp = timestamp;
 
-  // Display Rectangle with desired size, border, and color
-  tft.fillRect((x * LED_SIZE) + LED_BORDER, (y * LED_SIZE) + LED_BORDER, LED_SIZE - LED_BORDER, LED_SIZE - LED_BORDER, color); 
+  for(uint8_t series = 0;series < CHART_SERIES;++series)
+  {
+    int16_t value = values[series];
+    chartValues[series][slot] = value;
+    bool rescale = true;
+    if(chartCount == 1)
+    {
+      chartLow[series] = value - CHART_MIN_SPAN / 2;
+      chartHigh[series] = value + CHART_MIN_SPAN / 2;
+    }
+    else if(value < chartLow[series])
+    {
+      chartLow[series] = value - (chartHigh[series] - value) / 4;
+    }
+    else if(value > chartHigh[series])
+    {
+      chartHigh[series] = value + (value - chartLow[series]) / 4;
+    }
+    else
+    {
+      rescale = false;
+    }
+    if(currentView != DISPLAY_VIEW_CHART)
+      continue;
+    if(rescale)
+    {
+      drawChart(series);
+      continue;
+    }
+    drawChartColumn(series, slot);
+    drawChartColumn(series, chartNext);
+    drawChartLabel(series);
+  }
 }
@@ -17,10 +17,13 @@
 
 extern void initializeDisplay(int ledSize, int ledBorder, bool landscape);
 extern void displayWelcomeMessage(String msg1, String msg2);
-extern void displayMessage(int row, int column, String msg, int fontSize, int color);
+extern void displayMessage(int row, int column, const char *msg, int fontSize, int color);
 extern void clearDisplay();
 extern int getNumberLEDColumns();
 extern int getNumberLEDRows();
 extern void displayLED(int x, int y, int color);
+extern void updateDisplay();
+extern void setDisplayView(uint8_t view);
+extern void addChartPoint(uint32_t timestamp, int16_t temperature, uint16_t pressure, uint16_t humidity);
 
 #endif
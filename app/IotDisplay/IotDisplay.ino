@@ -9,6 +9,7 @@
  */
 
 #include "IotDisplay.h"
+#include "DisplayProtocol.h"
 
 #include <CytronWiFiShield.h>
 #include <CytronWiFiClient.h>
@@ -37,18 +38,83 @@ String appVersion = "Version 0.1";
 #define PORTRAIT  false
 #define LANDSCAPE true
 
+// Size of the legacy text Command line buffer (longer lines are discarded)
+#define COMMAND_LINE_SIZE 24
+
+// Most received bytes processed per loop pass (keeps the loop responsive while a burst of Commands arrives)
+#define COMMAND_BYTES_PER_PASS 64
+
+// LED colors indexed by the DISPLAY_COLOR_xxx values with the names used by the legacy text Commands
+typedef struct
+{
+  char name[8];
+  uint16_t value;
+} led_color;
+const led_color ledColors[] PROGMEM =
+{
+  { "BLACK", BLACK },
+  { "PURPLE", PURPLE },
+  { "RED", RED },
+  { "YELLOW", YELLOW },
+  { "WHITE", WHITE },
+};
+#define LED_COLOR_COUNT (sizeof(ledColors) / sizeof(ledColors[0]))
+
+// Binary Commands (see DisplayProtocol.h) and legacy text Commands (NAME=DATA)
+void commandLED(const uint8_t *args, uint8_t length);
+void commandClear(const uint8_t *args, uint8_t length);
+void commandHistory(const uint8_t *args, uint8_t length);
+void commandView(const uint8_t *args, uint8_t length);
+void textCommandLED(const char *data);
+typedef struct
+{
+  uint8_t opcode;
+  uint8_t args;                                   // Minimum number of arguments
+  void (*handler)(const uint8_t *args, uint8_t length);
+} frame_command;
+const frame_command frameCommands[] PROGMEM =
+{
+  { DISPLAY_OP_LED, 1, commandLED },
+  { DISPLAY_OP_CLEAR, 0, commandClear },
+  { DISPLAY_OP_HISTORY, 1, commandHistory },
+  { DISPLAY_OP_VIEW, 1, commandView },
+};
+typedef struct
+{
+  char name[8];
+  void (*handler)(const char *data);
+} text_command;
+const text_command textCommands[] PROGMEM =
+{
+  { "LED", textCommandLED },
+};
+
 int ledX, ledY = 0;
 bool hasConnectedToClient = false;
 IPAddress ipAddress;
 ESP8266Server server(8081);
 
+// Persistent connection to the Remote IoT Arduino and its partially received Command
+ESP8266Client client;
+uint8_t frame[DISPLAY_MAX_FRAME];
+uint8_t frameLength = 0;
+char line[COMMAND_LINE_SIZE];
+uint8_t lineLength = 0;
+bool lineOverflow = false;
+
+// Duplicate check of the binary Commands (reset by a HELLO from a new session)
+int session = -1;
+uint8_t lastSequence = 0;
+bool hasSequence = false;
+bool ackPending = false;
+
 /**
  * NAME: setup()
  * DESCRIPTION: Arduino Entry Point for setting up the application:
  * PROCESS:       Initialize Serial Port
  *                Connect to the Wifi Network
- *                Initialize LCD Display, display Welcome Message, and display Connectivity IP Address Message
- *                Clear the LCD Display
+ *                Initialize LCD Display, display Welcome Message
+ *                Clear the LCD Display and display Connectivity IP Address Message until the first Client connects
   * INPUTS: None
  * OUTPUTS: None
  * 
@@ -62,22 +128,22 @@ void setup()
   // Initialize and connect to WiFi module
   if(!wifi.begin(10, 11))
   {
-    Serial.println("Failed to connect to Wifi shield\n");
+    Serial.println(F("Failed to connect to Wifi shield\n"));
     while(1);
   }
   else
   {
-    Serial.println("Starting Wifi connection......\n");
+    Serial.println(F("Starting Wifi connection......\n"));
     if(!wifi.connectAP(SECRET_SSID, SECRET_PASS))
     {
-      Serial.println("Failed to connect to Wifi\n");
+      Serial.println(F("Failed to connect to Wifi\n"));
       while(1);
     }
     ipAddress = wifi.localIP();
-    Serial.print("Wifi connected to: ");Serial.println(wifi.SSID());
-    Serial.print("IP Address: ");Serial.println(ipAddress);
+    Serial.print(F("Wifi connected to: "));Serial.println(wifi.SSID());
+    Serial.print(F("IP Address: "));Serial.println(ipAddress);
     wifi.updateStatus();
-    Serial.print("Wifi status is: ");Serial.println(wifi.status());   //2- wifi connected with ip, 3- got connection with servers or clients, 4- disconnect with clients or servers, 5- no wifi
+    Serial.print(F("Wifi status is: "));Serial.println(wifi.status());   //2- wifi connected with ip, 3- got connection with servers or clients, 4- disconnect with clients or servers, 5- no wifi
     hasConnectedToClient = false;
     server.begin();
   }
@@ -89,17 +155,20 @@ void setup()
 
   // Clear the LED Display and wait for Commands from the Remote IoT Arduino
   clearDisplay();
+#if HAS_IOT
+  displayWaitingMessage();
+#endif
 }
 
 /**
  * NAME: loop()
  * DESCRIPTION: Arduino Entry Point for the application:
- * PROCESS:       Loop Forever
- *                  If not connected to remote Client then print IP Address and waiting Message to Serial Port
- *                  Check if connected to remote Client and if connected wait until a Display Command is received
- *                    Once Display Command is received then swith on Command: LED=[PURPLE | WHITE | YELLOW | RED]   
- *                    Update the LCD Display
- *                  Sleep
+ * PROCESS:       Loop Forever (never blocks so a Command is displayed in the pass it arrives)
+ *                  Keep the connection to the remote Client open (the first connection clears the waiting Message)
+ *                  Process up to COMMAND_BYTES_PER_PASS received bytes:
+ *                    Binary Command frames (see DisplayProtocol.h) are acknowledged once all the pipelined frames have been processed
+ *                    Legacy text Commands: LED=[PURPLE | WHITE | YELLOW | RED]
+ *                  Update the LCD Display (only the LED's that changed are drawn)
  * INPUTS: None
  * OUTPUTS: None
  * 
@@ -107,71 +176,264 @@ void setup()
 void loop() 
 {
 #if HAS_IOT
-  // Display the Wifi IP Address that the IoT Device can connect to and once first connection has been made clear the screen and display LED squares
-  if(!hasConnectedToClient)
-  {
-    String address = String("Connect your IoT Device to ") + ipAddress[0] + String(".") + ipAddress[1] + String(".") + ipAddress[2] + String(".") + ipAddress[3];
-    displayMessage(0, 0, address, 2, 0);
-    displayMessage(2, 0, "  Waiting to connect to IoT Device...", 2, 0);
-  }
-  ESP8266Client client = server.available();
-  if(client)
+  // Accept a new connection from the Remote IoT Arduino (the current one is kept until it is closed) and once first connection has been made clear the screen and display LED squares
+  if(!client.connected())
   {
-    Serial.println("Valid Client");
+    client = server.available();
+    if(!client)
+      return;
+    Serial.println(F("Valid Client"));
+    frameLength = 0;
+    lineLength = 0;
+    lineOverflow = false;
     if(!hasConnectedToClient)
     {
       hasConnectedToClient = true;
       clearDisplay();
     }
   }
-  else
-  {
-    Serial.println("No Client");
-  }
-      
-  // Wait for a Command from the Remote IoT Arduino
-  while(client.connected())
+
+  // Process the Commands received so far and acknowledge them
+  for(int i = 0;i < COMMAND_BYTES_PER_PASS && client.available() > 0;++i)
+    receiveByte(client.read());
+  updateDisplay();
+  if(ackPending && frameLength == 0)
   {
-    Serial.println("Waiting for command.....");
-    while(client.available() > 0)
-    {
-      // Get LED Display Command and Data
-      String req = client.readStringUntil('\n');
-      client.find("\n");     
-      Serial.print("Processing command.....");Serial.println(req);
-      char* cmd = strtok(req.c_str(), "=");
-      char* data = strtok(NULL, "=");
-
-      // Switch on Command
-      //  LED Display with a desired Color
-      if(strcmp(cmd, "LED") == 0)
-      {
-        int color = BLACK;
-        if(strcmp(data, "PURPLE") == 0)
-          color = PURPLE;
-        else if(strcmp(data, "WHITE") == 0)
-          color = WHITE;
-        else if(strcmp(data, "YELLOW") == 0)
-          color = YELLOW;
-        else if(strcmp(data, "RED") == 0)
-          color = RED;
-        else
-          color = BLACK;
-        displayLED(ledX, ledY, color);
-        calculateNextLED();
-      }
-    }
+    uint8_t ack[DISPLAY_FRAME_HEADER] = { DISPLAY_FRAME_START, 2, DISPLAY_OP_ACK, lastSequence };
+    client.write(ack, sizeof(ack));
+    ackPending = false;
   }
-  delay(10000);
 #else
   // Standalone LED Display Demo
   int color = calculateLEDColor();
   displayLED(ledX, ledY, color);
+  updateDisplay();
   delay(250);
   calculateNextLED();
 #endif
 }
 
+/**
+ * NAME: displayWaitingMessage()
+ * DESCRIPTION: Utility method to display the Wifi IP Address that the IoT Device can connect to (only drawn when the display enters the waiting state).
+ * INPUTS: None
+ * OUTPUTS: None
+ * 
+ */
+void displayWaitingMessage()
+{
+  char msg[44];
+  snprintf_P(msg, sizeof(msg), PSTR("Connect your IoT Device to %d.%d.%d.%d"), ipAddress[0], ipAddress[1], ipAddress[2], ipAddress[3]);
+  displayMessage(0, 0, msg, 2, 0);
+  strcpy_P(msg, PSTR("  Waiting to connect to IoT Device..."));
+  displayMessage(2, 0, msg, 2, 0);
+}
+
+/**
+ * NAME: receiveByte()
+ * DESCRIPTION: Utility method to collect a binary Command frame or a legacy text Command one byte at a time.
+ * PROCESS:   A frame starts with DISPLAY_FRAME_START and is processed once LENGTH bytes have followed it
+ *            Any other byte is part of a text Command that ends with a new line (a line longer than the buffer is discarded)
+ * INPUTS: c  The received byte
+ * OUTPUTS: None
+ * 
+ */
+void receiveByte(int c)
+{
+  if(frameLength == 0 && c != DISPLAY_FRAME_START)
+  {
+    if(c == '\n')
+    {
+      line[lineLength] = '\0';
+      if(!lineOverflow)
+        processTextCommand(line);
+      lineLength = 0;
+      lineOverflow = false;
+    }
+    else if(c != '\r')
+    {
+      if(lineLength < COMMAND_LINE_SIZE - 1)
+        line[lineLength++] = c;
+      else
+        lineOverflow = true;
+    }
+    return;
+  }
+  frame[frameLength++] = c;
+  if(frameLength == 2 && (frame[1] < 2 || frame[1] > DISPLAY_MAX_FRAME - 2))
+  {
+    frameLength = 0;
+  }
+  else if(frameLength > 2 && frameLength == frame[1] + 2)
+  {
+    processFrame(frame[2], frame[3], frame + DISPLAY_FRAME_HEADER, frame[1] - 2);
+    frameLength = 0;
+  }
+}
+
+/**
+ * NAME: processFrame()
+ * DESCRIPTION: Utility method to process a binary Command frame.
+ * PROCESS:   A HELLO from a new session resets the duplicate check
+ *            A Command with a sequence number that was already processed (sent again after a reconnect) is skipped but still acknowledged
+ *            Otherwise the handler for the opcode is looked up in the Command table
+ * INPUTS: opcode     Command opcode
+ *         sequence   Command sequence number
+ *         args       Command arguments
+ *         length     Number of arguments
+ * OUTPUTS: None
+ * 
+ */
+void processFrame(uint8_t opcode, uint8_t sequence, const uint8_t *args, uint8_t length)
+{
+  if(opcode == DISPLAY_OP_HELLO)
+  {
+    if(length >= 1 && args[0] != session)
+    {
+      session = args[0];
+      hasSequence = false;
+    }
+    return;
+  }
+  ackPending = true;
+  if(hasSequence && (int8_t)(sequence - lastSequence) <= 0)
+    return;
+  lastSequence = sequence;
+  hasSequence = true;
+
+  // Switch on Command
+  for(uint8_t i = 0;i < sizeof(frameCommands) / sizeof(frameCommands[0]);++i)
+  {
+    if(pgm_read_byte(&frameCommands[i].opcode) == opcode)
+    {
+      if(length >= pgm_read_byte(&frameCommands[i].args))
+        ((void (*)(const uint8_t *, uint8_t))pgm_read_ptr(&frameCommands[i].handler))(args, length);
+      return;
+    }
+  }
+}
+
+/**
+ * NAME: processTextCommand()
+ * DESCRIPTION: Utility method to process a legacy text Command (NAME=DATA) by looking up the handler for NAME in the Command table.
+ * INPUTS: req  The Command line (modified)
+ * OUTPUTS: None
+ * 
+ */
+void processTextCommand(char *req)
+{
+  Serial.print(F("Processing command....."));Serial.println(req);
+  char *data = strchr(req, '=');
+  if(data == NULL)
+    return;
+  *data++ = '\0';
+
+  // Switch on Command
+  for(uint8_t i = 0;i < sizeof(textCommands) / sizeof(textCommands[0]);++i)
+  {
+    if(strcmp_P(req, textCommands[i].name) == 0)
+    {
+      ((void (*)(const char *))pgm_read_ptr(&textCommands[i].handler))(data);
+      return;
+    }
+  }
+}
+
+/**
+ * NAME: commandLED()
+ * DESCRIPTION: Binary Command handler to display the next LED with a DISPLAY_COLOR_xxx color.
+ * INPUTS: args     Command arguments (color)
+ *         length   Number of arguments
+ * OUTPUTS: None
+ * 
+ */
+void commandLED(const uint8_t *args, uint8_t length)
+{
+  displayLED(ledX, ledY, getLEDColor(args[0]));
+  calculateNextLED();
+}
+
+/**
+ * NAME: commandClear()
+ * DESCRIPTION: Binary Command handler to clear the LED's and start again from the top of the Grid.
+ * INPUTS: args     Command arguments (none)
+ *         length   Number of arguments
+ * OUTPUTS: None
+ * 
+ */
+void commandClear(const uint8_t *args, uint8_t length)
+{
+  clearDisplay();
+  ledX = 0;
+  ledY = 0;
+}
+
+/**
+ * NAME: commandHistory()
+ * DESCRIPTION: Binary Command handler to add a batch of sensor data points to the charts.
+ * INPUTS: args     Command arguments (count followed by count points, see DisplayProtocol.h)
+ *         length   Number of arguments
+ * OUTPUTS: None
+ * 
+ */
+void commandHistory(const uint8_t *args, uint8_t length)
+{
+  uint8_t count = args[0];
+  if(length < 1 + count * DISPLAY_POINT_SIZE)
+    return;
+  for(const uint8_t *point = args + 1;count-- > 0;point += DISPLAY_POINT_SIZE)
+  {
+    uint32_t timestamp = point[0] | ((uint32_t)point[1] << 8) | ((uint32_t)point[2] << 16) | ((uint32_t)point[3] << 24);
+    addChartPoint(timestamp, point[4] | (point[5] << 8), point[6] | (point[7] << 8), point[8] | (point[9] << 8));
+  }
+}
+
+/**
+ * NAME: commandView()
+ * DESCRIPTION: Binary Command handler to show the LED's or the charts.
+ * INPUTS: args     Command arguments (DISPLAY_VIEW_LEDS or DISPLAY_VIEW_CHART)
+ *         length   Number of arguments
+ * OUTPUTS: None
+ * 
+ */
+void commandView(const uint8_t *args, uint8_t length)
+{
+  setDisplayView(args[0]);
+}
+
+/**
+ * NAME: textCommandLED()
+ * DESCRIPTION: Text Command handler to display the next LED with a color name: LED=[PURPLE | WHITE | YELLOW | RED] (an unknown color is displayed as BLACK).
+ * INPUTS: data   The color name
+ * OUTPUTS: None
+ * 
+ */
+void textCommandLED(const char *data)
+{
+  uint8_t color = DISPLAY_COLOR_BLACK;
+  for(uint8_t i = 0;i < LED_COLOR_COUNT;++i)
+  {
+    if(strcmp_P(data, ledColors[i].name) == 0)
+      color = i;
+  }
+  displayLED(ledX, ledY, getLEDColor(color));
+  calculateNextLED();
+}
+
+/**
+ * NAME: getLEDColor()
+ * DESCRIPTION: Utility method to get the LCD color of a DISPLAY_COLOR_xxx value from the color table.
+ * INPUTS: color  DISPLAY_COLOR_xxx value
+ * OUTPUTS: LED Color Value (BLACK if unknown)
+ * 
+ */
+int getLEDColor(uint8_t color)
+{
+  if(color >= LED_COLOR_COUNT)
+    return BLACK;
+  return pgm_read_word(&ledColors[color].value);
+}
+
 /**
  * NAME: calculateLEDColor()
  * DESCRIPTION: Utility test method to cycle thru colors based on current X and Y LED screen location.
@@ -181,12 +443,12 @@ void loop()
  */
 int calculateLEDColor()
 {
-  int color = (ledY & 1) ? (ledX & 1 ? PURPLE : WHITE) : (ledX & 1 ? WHITE : PURPLE);
+  uint8_t color = (ledY & 1) ? (ledX & 1 ? DISPLAY_COLOR_PURPLE : DISPLAY_COLOR_WHITE) : (ledX & 1 ? DISPLAY_COLOR_WHITE : DISPLAY_COLOR_PURPLE);
   if(ledX == 5 && ledY == 1)
-    color = YELLOW;
+    color = DISPLAY_COLOR_YELLOW;
   if(ledX == 6 && ledY == 4)
-    color = RED;
-  return color; 
+    color = DISPLAY_COLOR_RED;
+  return getLEDColor(color); 
 }
 
 /**
@@ -1,12 +1,36 @@
 #include "AccessPoint.h"
 #include <WiFiNINA.h>
-#include <ArduinoLog.h>
+#include "LogBuffer.h"
+#include "Endpoints.h"
 
 char ssidAP[] = "IoTAccessPoint";        
 WiFiServer serverAP(80);
 String configuredSSID = "";
 String configuredSSID_PW = "";
 String configuredDisplay_IP = "";
+String configuredForm = "";
+
+// Decode a form field value (application/x-www-form-urlencoded)
+static String urlDecode(const String &value)
+{
+  String decoded = "";
+  for (unsigned int i = 0;i < value.length();++i)
+  {
+    char c = value[i];
+    if (c == '+')
+    {
+      c = ' ';
+    }
+    else if (c == '%' && i + 2 < value.length())
+    {
+      char hex[3] = { value[i+1], value[i+2], '\0' };
+      c = (char)strtol(hex, NULL, 16);
+      i += 2;
+    }
+    decoded += c;
+  }
+  return decoded;
+}
 
 bool accessPoint()
 {
@@ -14,30 +38,30 @@ bool accessPoint()
   int status = WL_IDLE_STATUS;
   
   // Create Access Point
-  Log.verbose(F("Access Point Web Server\n"));
+  LOG_VERBOSE(F("Access Point Web Server\n"));
   if (WiFi.status() == WL_NO_SHIELD)
   {
-    Log.verbose(F("WiFi shield not present\n"));
+    LOG_VERBOSE(F("WiFi shield not present\n"));
     return false;
   }
-  Log.verbose(F("Creating Access Point named: %s\n"), ssidAP);
+  LOG_VERBOSE(F("Creating Access Point named: %s\n"), ssidAP);
   status = WiFi.beginAP(ssidAP);
   if (status != WL_AP_LISTENING) 
   {
-    Log.verbose(F("Creating Access Point failed"));
+    LOG_VERBOSE(F("Creating Access Point failed"));
     return false;
   }
 
   // Start Server with Access Point and print connectivity information
   delay(5000);
   serverAP.begin();
-  Log.verbose(F("Connect your Wifi to this Access Point SSID: %s\n"), WiFi.SSID());
+  LOG_VERBOSE(F("Connect your Wifi to this Access Point SSID: %s\n"), WiFi.SSID());
   do
   {
     status = WiFi.status();
   }while (status != WL_AP_CONNECTED);
-  Log.verbose(F("Connected to Access Point\n"));
-  Log.verbose(F("Open a browser to http://%d.%d.%d.%d\n"), WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
+  LOG_VERBOSE(F("Connected to Access Point\n"));
+  LOG_VERBOSE(F("Open a browser to http://%d.%d.%d.%d\n"), WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
   
   // Listen for incoming requests and once connected display the Configuration Page
   bool done = false;
@@ -47,7 +71,7 @@ bool accessPoint()
     {
       client = serverAP.available();
     }while (!client);
-    Log.verbose(F("Connected to Access Point\n"));
+    LOG_VERBOSE(F("Connected to Access Point\n"));
     String currentLine = "";
     bool processFormPost = false;
     while (client.connected()) 
@@ -74,6 +98,29 @@ bool accessPoint()
             client.print("  SSID: <input name=\"ssid\" type=\"text\" maxlength=\"25\" placeholder=\"Enter SSID\" required><br/>");
             client.print("  Password: <input name=\"password\" type=\"password\" maxlength=\"25\" placeholder=\"Enter SSID Password\"><br/>");
             client.print("  Display IP Address: <input name=\"ipaddress\" type=\"text\" maxlength=\"15\" placeholder=\"Enter Display IP Address\" pattern=\"\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}\\.\\d{1,3}\" required><br/>");
+
+            // Print out the REST Endpoints with a check box to enable each of them and the fields to replace one of them
+            client.print("<h3>REST Endpoints</h3>");
+            for (int i = 0;i < ENDPOINT_SLOTS;++i)
+            {
+              const endpoint *ep = endpointGet(i);
+              client.print("  <input name=\"e");
+              client.print(i);
+              client.print("\" type=\"checkbox\" value=\"1\"");
+              if (endpointsEnabled() & (1 << i))
+                client.print(" checked");
+              client.print("> ");
+              client.print(i + 1);
+              client.print(": ");
+              client.print(ep != NULL ? ep->host : "(empty)");
+              client.print("<br/>");
+            }
+            client.print("  Replace Endpoint: <select name=\"slot\"><option value=\"\">None</option><option value=\"0\">1</option><option value=\"1\">2</option><option value=\"2\">3</option><option value=\"3\">4</option></select><br/>");
+            client.print("  Host: <input name=\"host\" type=\"text\" maxlength=\"47\" placeholder=\"Enter Endpoint Host\"><br/>");
+            client.print("  Port: <input name=\"port\" type=\"number\" min=\"1\" max=\"65535\" value=\"80\"><br/>");
+            client.print("  Path: <input name=\"path\" type=\"text\" maxlength=\"39\" placeholder=\"/rest/weather/save\"><br/>");
+            client.print("  Format: <select name=\"format\"><option value=\"0\">JSON</option><option value=\"1\">CBOR</option></select><br/>");
+            client.print("  (the replacement is POSTed without Basic Authentication)<br/>");
             client.print("  <input type=\"submit\" value=\"Submit\">");
             client.print("</form>");
             client.print("</body>");
@@ -108,16 +155,11 @@ bool accessPoint()
             }
 
             // Parse the Form Data
-            int n1 = currentLine.indexOf('&');
-            String s1 = currentLine.substring(0, n1);
-            int n2 = currentLine.lastIndexOf('&');
-            String s2 = currentLine.substring(n1+1, n2);
-            String s3 = currentLine.substring(n2+1);
-            configuredSSID = s1.substring(s1.indexOf('=')+1);
-            configuredSSID_PW = s2.substring(s2.indexOf('=')+1);
-            configuredDisplay_IP = s3.substring(s3.indexOf('=')+1);
+            configuredForm = currentLine;
+            configuredSSID = getConfiguredValue("ssid");
+            configuredSSID_PW = getConfiguredValue("password");
+            configuredDisplay_IP = getConfiguredValue("ipaddress");
             
-            configuredSSID.replace('+', ' ');
             configuredSSID.trim();
             configuredSSID_PW.trim();
             configuredDisplay_IP.trim();             
@@ -140,9 +182,9 @@ bool accessPoint()
        
     // close the connection:
     client.stop();
-    Log.verbose(F("Access Point disconnected\n"));
+    LOG_VERBOSE(F("Access Point disconnected\n"));
   }
-  Log.verbose(F("Done with Access Point\n"));
+  LOG_VERBOSE(F("Done with Access Point\n"));
   return true;
 }
 
@@ -160,3 +202,22 @@ String getConfiguredDisplayIP()
 {
   return configuredDisplay_IP;
 }
+
+String getConfiguredValue(const char *name)
+{
+  // Find name=value in the Form Data (name must be at the start or follow a '&')
+  String key = String(name) + "=";
+  int start = 0;
+  while (true)
+  {
+    int n = configuredForm.indexOf(key, start);
+    if (n < 0)
+      return "";
+    if (n == 0 || configuredForm[n-1] == '&')
+    {
+      int end = configuredForm.indexOf('&', n);
+      return urlDecode(configuredForm.substring(n + key.length(), end < 0 ? configuredForm.length() : end));
+    }
+    start = n + 1;
+  }
+}
@@ -7,5 +7,6 @@ extern bool accessPoint();
 extern String getConfiguredSSID();
 extern String getConfiguredPW();
 extern String getConfiguredDisplayIP();
+extern String getConfiguredValue(const char *name);
 
 #endif
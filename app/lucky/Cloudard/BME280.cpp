@@ -16,7 +16,9 @@
  ***************************************************************************/
 #include "Arduino.h"
 #include <Wire.h>
+#include <EEPROM.h>
 #include "BME280.h"
+#include "I2CStats.h"
 
 #ifdef __SAM3X8E__
 #define Wire Wire1
@@ -27,18 +29,136 @@
  ***************************************************************************/
 
 
+BME280::BME280(void)
+{
+  _cacheAddress = -1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables caching of the calibration data in EEPROM at the given
+            address (call before begin(), -1 disables the cache)
+*/
+/**************************************************************************/
+void BME280::setCalibrationCache(int address)
+{
+  _cacheAddress = address;
+}
+
 bool BME280::begin(uint8_t a) {
   _i2caddr = a;
 
-  if (read8(BME280_REGISTER_CHIPID) != 0x60)
+  _sensorID = read8(BME280_REGISTER_CHIPID);
+  if (_sensorID != BME280_CHIPID)
     return false;
 
-  readCoefficients();
+  if (!loadCoefficients())
+  {
+    readCoefficients();
+    saveCoefficients();
+  }
+
+  // 16x oversampling, normal mode until the application selects a profile
+  bme280_settings settings = { BME280_MODE_NORMAL, BME280_SAMPLING_X16, BME280_SAMPLING_X16,
+                               BME280_SAMPLING_X16, BME280_FILTER_OFF, BME280_STANDBY_MS_0_5 };
+  setSampling(settings);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the oversampling, IIR filter, standby time and mode
+*/
+/**************************************************************************/
+void BME280::setSampling(const bme280_settings &settings)
+{
+  _settings = settings;
+
+  // Config is only guaranteed to be written in sleep mode (DS 5.4.6)
+  write8(BME280_REGISTER_CONTROL, BME280_MODE_SLEEP);
+  write8(BME280_REGISTER_CONFIG, (settings.standby << 5) | (settings.filter << 2));
 
   //Set before CONTROL_meas (DS 5.4.3)
-  write8(BME280_REGISTER_CONTROLHUMID, 0x05); //16x oversampling 
+  write8(BME280_REGISTER_CONTROLHUMID, settings.osrs_h);
+
+  // In forced mode the conversion is started by measure()
+  uint8_t mode = settings.mode == BME280_MODE_FORCED ? BME280_MODE_SLEEP : settings.mode;
+  write8(BME280_REGISTER_CONTROL, (settings.osrs_t << 5) | (settings.osrs_p << 2) | mode);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Selects one of the recommended modes of operation (DS 3.5)
+*/
+/**************************************************************************/
+void BME280::setProfile(bme280_profile profile)
+{
+  bme280_settings settings;
+
+  switch (profile)
+  {
+    case BME280_PROFILE_HUMIDITY_SENSING:
+      settings = { BME280_MODE_FORCED, BME280_SAMPLING_X1, BME280_SAMPLING_NONE,
+                   BME280_SAMPLING_X1, BME280_FILTER_OFF, BME280_STANDBY_MS_0_5 };
+      break;
+    case BME280_PROFILE_INDOOR_NAVIGATION:
+      settings = { BME280_MODE_NORMAL, BME280_SAMPLING_X2, BME280_SAMPLING_X16,
+                   BME280_SAMPLING_X1, BME280_FILTER_X16, BME280_STANDBY_MS_0_5 };
+      break;
+    case BME280_PROFILE_GAMING:
+      settings = { BME280_MODE_NORMAL, BME280_SAMPLING_X1, BME280_SAMPLING_X4,
+                   BME280_SAMPLING_NONE, BME280_FILTER_X16, BME280_STANDBY_MS_0_5 };
+      break;
+    case BME280_PROFILE_WEATHER_MONITORING:
+    default:
+      settings = { BME280_MODE_FORCED, BME280_SAMPLING_X1, BME280_SAMPLING_X1,
+                   BME280_SAMPLING_X1, BME280_FILTER_OFF, BME280_STANDBY_MS_0_5 };
+      break;
+  }
+  setSampling(settings);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Maximum measurement time in ms for the current settings (DS 9.1)
+*/
+/**************************************************************************/
+uint16_t BME280::measurementTime(void)
+{
+  static const uint8_t samples[] = { 0, 1, 2, 4, 8, 16 };
+  uint8_t t = samples[_settings.osrs_t];
+  uint8_t p = samples[_settings.osrs_p];
+  uint8_t h = samples[_settings.osrs_h];
+
+  // 1.25 + 2.3 * T + (2.3 * P + 0.575) + (2.3 * H + 0.575) in microseconds
+  uint32_t us = 1250 + 2300UL * t + (p ? 2300UL * p + 575 : 0) + (h ? 2300UL * h + 575 : 0);
+  return (us + 999) / 1000;
+}
 
-  write8(BME280_REGISTER_CONTROL, 0xB7); // 16x ovesampling, normal mode
+/**************************************************************************/
+/*!
+    @brief  Triggers a single forced mode conversion and polls the status
+            register until the result is ready
+
+    @return False if the conversion did not finish in time
+*/
+/**************************************************************************/
+bool BME280::measure(void)
+{
+  if (_settings.mode != BME280_MODE_FORCED)
+    return true;
+
+  write8(BME280_REGISTER_CONTROL, (_settings.osrs_t << 5) | (_settings.osrs_p << 2) | BME280_MODE_FORCED);
+
+  // Allow twice the datasheet maximum before giving up
+  uint16_t timeout = measurementTime() * 2;
+  unsigned long start = millis();
+  while (read8(BME280_REGISTER_STATUS) & 0x08)
+  {
+    if (millis() - start > timeout)
+      return false;
+    delay(1);
+  }
   return true;
 }
 
@@ -54,6 +174,7 @@ void BME280::write8(byte reg, byte value)
     Wire.write((uint8_t)reg);
     Wire.write((uint8_t)value);
     Wire.endTransmission();
+    I2C_STATS_WRITE(1);
 }
 
 /**************************************************************************/
@@ -70,6 +191,7 @@ uint8_t BME280::read8(byte reg)
   Wire.endTransmission();
   Wire.requestFrom((uint8_t)_i2caddr, (byte)1);
   value = Wire.read();
+  I2C_STATS_READ(1);
   return value;
 }
 
@@ -87,6 +209,7 @@ uint16_t BME280::read16(byte reg)
     Wire.endTransmission();
     Wire.requestFrom((uint8_t)_i2caddr, (byte)2);
     value = (Wire.read() << 8) | Wire.read();
+    I2C_STATS_READ(2);
 
   return value;
 }
@@ -129,6 +252,7 @@ uint32_t BME280::read24(byte reg)
     Wire.write((uint8_t)reg);
     Wire.endTransmission();
     Wire.requestFrom((uint8_t)_i2caddr, (byte)3);
+    I2C_STATS_READ(3);
     
     value = Wire.read();
     value <<= 8;
@@ -139,6 +263,23 @@ uint32_t BME280::read24(byte reg)
   return value;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Reads a block of consecutive registers in one I2C transaction
+*/
+/**************************************************************************/
+void BME280::readBurst(byte reg, uint8_t *buffer, uint8_t length)
+{
+    Wire.beginTransmission((uint8_t)_i2caddr);
+    Wire.write((uint8_t)reg);
+    Wire.endTransmission();
+    Wire.requestFrom((uint8_t)_i2caddr, (byte)length);
+
+    for (uint8_t i = 0; i < length; i++)
+      buffer[i] = Wire.read();
+    I2C_STATS_READ(length);
+}
+
 
 /**************************************************************************/
 /*!
@@ -147,26 +288,165 @@ uint32_t BME280::read24(byte reg)
 /**************************************************************************/
 void BME280::readCoefficients(void)
 {
-    _bme280_calib.dig_T1 = read16_LE(BME280_REGISTER_DIG_T1);
-    _bme280_calib.dig_T2 = readS16_LE(BME280_REGISTER_DIG_T2);
-    _bme280_calib.dig_T3 = readS16_LE(BME280_REGISTER_DIG_T3);
+    uint8_t tp[26];
+    uint8_t h[7];
+
+    // Calibration is stored in two blocks: 0x88-0xA1 and 0xE1-0xE7 (DS 5.4.2)
+    readBurst(BME280_REGISTER_DIG_T1, tp, sizeof(tp));
+    readBurst(BME280_REGISTER_DIG_H2, h, sizeof(h));
+
+    _bme280_calib.dig_T1 = (uint16_t)(tp[1] << 8) | tp[0];
+    _bme280_calib.dig_T2 = (int16_t)((tp[3] << 8) | tp[2]);
+    _bme280_calib.dig_T3 = (int16_t)((tp[5] << 8) | tp[4]);
+
+    _bme280_calib.dig_P1 = (uint16_t)(tp[7] << 8) | tp[6];
+    _bme280_calib.dig_P2 = (int16_t)((tp[9] << 8) | tp[8]);
+    _bme280_calib.dig_P3 = (int16_t)((tp[11] << 8) | tp[10]);
+    _bme280_calib.dig_P4 = (int16_t)((tp[13] << 8) | tp[12]);
+    _bme280_calib.dig_P5 = (int16_t)((tp[15] << 8) | tp[14]);
+    _bme280_calib.dig_P6 = (int16_t)((tp[17] << 8) | tp[16]);
+    _bme280_calib.dig_P7 = (int16_t)((tp[19] << 8) | tp[18]);
+    _bme280_calib.dig_P8 = (int16_t)((tp[21] << 8) | tp[20]);
+    _bme280_calib.dig_P9 = (int16_t)((tp[23] << 8) | tp[22]);
+
+    _bme280_calib.dig_H1 = tp[25];
+    _bme280_calib.dig_H2 = (int16_t)((h[1] << 8) | h[0]);
+    _bme280_calib.dig_H3 = h[2];
+    _bme280_calib.dig_H4 = ((int16_t)(int8_t)h[3] << 4) | (h[4] & 0xF);
+    _bme280_calib.dig_H5 = ((int16_t)(int8_t)h[5] << 4) | (h[4] >> 4);
+    _bme280_calib.dig_H6 = (int8_t)h[6];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checksum of the chip ID and calibration data used to validate
+            the EEPROM cache
+*/
+/**************************************************************************/
+uint8_t BME280::coefficientsChecksum(void)
+{
+    const uint8_t *data = (const uint8_t *)&_bme280_calib;
+    uint8_t crc = (uint8_t)_sensorID;
+
+    // CRC-8, polynomial 0x31
+    for (uint8_t i = 0; i < sizeof(bme280_calib_data); i++)
+    {
+      crc ^= data[i];
+      for (uint8_t bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : (crc << 1);
+    }
+    return crc;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Loads the coefficients from the EEPROM cache
+
+    @return False if the cache is disabled or does not hold valid data for
+            this chip
+*/
+/**************************************************************************/
+bool BME280::loadCoefficients(void)
+{
+    if (_cacheAddress < 0)
+      return false;
+
+    // Cache layout: chip ID, calibration data, checksum
+    if (EEPROM.read(_cacheAddress) != (uint8_t)_sensorID)
+      return false;
+
+    EEPROM.get(_cacheAddress + 1, _bme280_calib);
+    return EEPROM.read(_cacheAddress + 1 + sizeof(bme280_calib_data)) == coefficientsChecksum();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stores the coefficients in the EEPROM cache
+*/
+/**************************************************************************/
+void BME280::saveCoefficients(void)
+{
+    if (_cacheAddress < 0)
+      return;
+
+    EEPROM.update(_cacheAddress, (uint8_t)_sensorID);
+    EEPROM.put(_cacheAddress + 1, _bme280_calib);
+    EEPROM.update(_cacheAddress + 1 + sizeof(bme280_calib_data), coefficientsChecksum());
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the raw ADC values of all three measurements in a single
+            burst
+
+    @return False if the forced mode conversion did not finish in time (the
+            data registers still hold the previous result)
+*/
+/**************************************************************************/
+bool BME280::readRaw(int32_t *adc_T, int32_t *adc_P, int32_t *adc_H)
+{
+  uint8_t data[8];
+
+  // In forced mode take a fresh conversion instead of the last result
+  if (!measure())
+    return false;
+
+  // Pressure (0xF7-0xF9), temperature (0xFA-0xFC) and humidity (0xFD-0xFE)
+  // are contiguous so they can be read in one transaction (DS 4)
+  readBurst(BME280_REGISTER_PRESSUREDATA, data, sizeof(data));
+
+  *adc_P = ((uint32_t)data[0] << 12) | ((uint32_t)data[1] << 4) | (data[2] >> 4);
+  *adc_T = ((uint32_t)data[3] << 12) | ((uint32_t)data[4] << 4) | (data[5] >> 4);
+  *adc_H = ((uint32_t)data[6] << 8) | data[7];
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads all three measurements in a single burst and compensates
+            them using one t_fine calculation
+
+    @return NAN in every measurement if the conversion did not finish
+*/
+/**************************************************************************/
+bme280_sample BME280::readAll(void)
+{
+  int32_t adc_T, adc_P, adc_H;
+  bme280_sample sample;
+
+  if (!readRaw(&adc_T, &adc_P, &adc_H))
+  {
+    sample.temperature = sample.pressure = sample.humidity = NAN;
+    return sample;
+  }
+
+  // Temperature must be done first to get t_fine
+  sample.temperature = (float)compensateTemperature(adc_T) / 100;
+  sample.pressure = (float)compensatePressure(adc_P) / 256;
+  sample.humidity = (float)compensateHumidity(adc_H) / 1024.0;
+  return sample;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Same as readAll() but gets the integer compensated values
+            without any floating point arithmetic
+
+    @return False if the conversion did not finish (sample is unchanged)
+*/
+/**************************************************************************/
+bool BME280::readAllFixed(bme280_sample_fixed &sample)
+{
+  int32_t adc_T, adc_P, adc_H;
 
-    _bme280_calib.dig_P1 = read16_LE(BME280_REGISTER_DIG_P1);
-    _bme280_calib.dig_P2 = readS16_LE(BME280_REGISTER_DIG_P2);
-    _bme280_calib.dig_P3 = readS16_LE(BME280_REGISTER_DIG_P3);
-    _bme280_calib.dig_P4 = readS16_LE(BME280_REGISTER_DIG_P4);
-    _bme280_calib.dig_P5 = readS16_LE(BME280_REGISTER_DIG_P5);
-    _bme280_calib.dig_P6 = readS16_LE(BME280_REGISTER_DIG_P6);
-    _bme280_calib.dig_P7 = readS16_LE(BME280_REGISTER_DIG_P7);
-    _bme280_calib.dig_P8 = readS16_LE(BME280_REGISTER_DIG_P8);
-    _bme280_calib.dig_P9 = readS16_LE(BME280_REGISTER_DIG_P9);
+  if (!readRaw(&adc_T, &adc_P, &adc_H))
+    return false;
 
-    _bme280_calib.dig_H1 = read8(BME280_REGISTER_DIG_H1);
-    _bme280_calib.dig_H2 = readS16_LE(BME280_REGISTER_DIG_H2);
-    _bme280_calib.dig_H3 = read8(BME280_REGISTER_DIG_H3);
-    _bme280_calib.dig_H4 = (read8(BME280_REGISTER_DIG_H4) << 4) | (read8(BME280_REGISTER_DIG_H4+1) & 0xF);
-    _bme280_calib.dig_H5 = (read8(BME280_REGISTER_DIG_H5+1) << 4) | (read8(BME280_REGISTER_DIG_H5) >> 4);
-    _bme280_calib.dig_H6 = (int8_t)read8(BME280_REGISTER_DIG_H6);
+  // Temperature must be done first to get t_fine
+  sample.temperature = compensateTemperature(adc_T);
+  sample.pressure = (compensatePressure(adc_P) + 128) >> 8;
+  sample.humidity = compensateHumidity(adc_H);
+  return true;
 }
 
 /**************************************************************************/
@@ -176,10 +456,39 @@ void BME280::readCoefficients(void)
 /**************************************************************************/
 float BME280::temperature(void)
 {
-  int32_t var1, var2;
+  return readAll().temperature;
+}
+
+/**************************************************************************/
+/*!
 
-  int32_t adc_T = read24(BME280_REGISTER_TEMPDATA);
-  adc_T >>= 4;
+*/
+/**************************************************************************/
+float BME280::pressure(void)
+{
+  return readAll().pressure;
+}
+
+/**************************************************************************/
+/*!
+
+*/
+/**************************************************************************/
+float BME280::humidity(void)
+{
+  return readAll().humidity;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Compensates a raw temperature reading and updates t_fine
+
+    @return Temperature in 0.01 degrees C
+*/
+/**************************************************************************/
+int32_t BME280::compensateTemperature(int32_t adc_T)
+{
+  int32_t var1, var2;
 
   var1  = ((((adc_T>>3) - ((int32_t)_bme280_calib.dig_T1 <<1))) *
 	   ((int32_t)_bme280_calib.dig_T2)) >> 11;
@@ -190,22 +499,46 @@ float BME280::temperature(void)
 
   t_fine = var1 + var2;
 
-  float T  = (t_fine * 5 + 128) >> 8;
-  return T/100;
+  return (t_fine * 5 + 128) >> 8;
 }
 
 /**************************************************************************/
 /*!
+    @brief  Compensates a raw pressure reading (t_fine must be current)
 
+    @return Pressure in Pa as Q24.8 (the fraction is always 0 with the
+            32-bit backend)
 */
 /**************************************************************************/
-float BME280::pressure(void) {
-  int64_t var1, var2, p;
+uint32_t BME280::compensatePressure(int32_t adc_P)
+{
+#if BME280_PRESSURE_32BIT
+  int32_t var1, var2;
+  uint32_t p;
 
-  temperature(); // must be done first to get t_fine
+  var1 = (((int32_t)t_fine)>>1) - (int32_t)64000;
+  var2 = (((var1>>2) * (var1>>2)) >> 11) * ((int32_t)_bme280_calib.dig_P6);
+  var2 = var2 + ((var1*((int32_t)_bme280_calib.dig_P5))<<1);
+  var2 = (var2>>2) + (((int32_t)_bme280_calib.dig_P4)<<16);
+  var1 = (((_bme280_calib.dig_P3 * (((var1>>2) * (var1>>2)) >> 13)) >> 3) +
+    ((((int32_t)_bme280_calib.dig_P2) * var1)>>1))>>18;
+  var1 = ((((32768+var1))*((int32_t)_bme280_calib.dig_P1))>>15);
 
-  int32_t adc_P = read24(BME280_REGISTER_PRESSUREDATA);
-  adc_P >>= 4;
+  if (var1 == 0) {
+    return 0;  // avoid exception caused by division by zero
+  }
+  p = (((uint32_t)(((int32_t)1048576)-adc_P)-(var2>>12)))*3125;
+  if (p < 0x80000000)
+    p = (p << 1) / ((uint32_t)var1);
+  else
+    p = (p / (uint32_t)var1) * 2;
+  var1 = (((int32_t)_bme280_calib.dig_P9) * ((int32_t)(((p>>3) * (p>>3))>>13)))>>12;
+  var2 = (((int32_t)(p>>2)) * ((int32_t)_bme280_calib.dig_P8))>>13;
+
+  p = (uint32_t)((int32_t)p + ((var1 + var2 + _bme280_calib.dig_P7) >> 4));
+  return p << 8;
+#else
+  int64_t var1, var2, p;
 
   var1 = ((int64_t)t_fine) - 128000;
   var2 = var1 * var1 * (int64_t)_bme280_calib.dig_P6;
@@ -224,21 +557,19 @@ float BME280::pressure(void) {
   var2 = (((int64_t)_bme280_calib.dig_P8) * p) >> 19;
 
   p = ((p + var1 + var2) >> 8) + (((int64_t)_bme280_calib.dig_P7)<<4);
-  return (float)p/256;
+  return (uint32_t)p;
+#endif
 }
 
-
 /**************************************************************************/
 /*!
+    @brief  Compensates a raw humidity reading (t_fine must be current)
 
+    @return Relative humidity in %RH as Q22.10
 */
 /**************************************************************************/
-float BME280::humidity(void) {
-
-  temperature(); // must be done first to get t_fine
-
-  int32_t adc_H = read16(BME280_REGISTER_HUMIDDATA);
-
+uint32_t BME280::compensateHumidity(int32_t adc_H)
+{
   int32_t v_x1_u32r;
 
   v_x1_u32r = (t_fine - ((int32_t)76800));
@@ -254,8 +585,7 @@ float BME280::humidity(void) {
 
   v_x1_u32r = (v_x1_u32r < 0) ? 0 : v_x1_u32r;
   v_x1_u32r = (v_x1_u32r > 419430400) ? 419430400 : v_x1_u32r;
-  float h = (v_x1_u32r>>12);
-  return  h / 1024.0;
+  return (uint32_t)(v_x1_u32r>>12);
 }
 
 /**************************************************************************/
@@ -280,4 +610,35 @@ float BME280::altitude(float seaLevel)
   return 44330.0 * (1.0 - pow(atmospheric / seaLevel, 0.1903));
 }
 
+/**************************************************************************/
+/*!
+    @brief  Converts 0.01 degrees C to 0.01 degrees F
+*/
+/**************************************************************************/
+int16_t BME280::fahrenheitX100(int32_t centiCelsius)
+{
+  int32_t f = centiCelsius * 9;
+  return (int16_t)((f + (f < 0 ? -2 : 2)) / 5 + 3200);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts Pa to 0.01 inHg (1 inHg = 3386.38 Pa)
+*/
+/**************************************************************************/
+uint16_t BME280::inHgX100(uint32_t pascals)
+{
+  return (uint16_t)((pascals * 10000UL + 169319UL) / 338638UL);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Converts %RH as Q22.10 to 0.01 %RH
+*/
+/**************************************************************************/
+uint16_t BME280::humidityX100(uint32_t humidityQ22_10)
+{
+  return (uint16_t)((humidityQ22_10 * 100 + 512) >> 10);
+}
+
 BME280 bme280;
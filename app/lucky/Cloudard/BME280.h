@@ -27,10 +27,23 @@
 
 #include <Wire.h>
 
+/*=========================================================================
+    COMPENSATION BACKEND
+    -----------------------------------------------------------------------
+    1 = Bosch 32-bit integer pressure formula (1 Pa resolution, no int64_t
+        arithmetic which is expensive on 8-bit AVR)
+    0 = Bosch 64-bit integer pressure formula (1/256 Pa resolution)
+    -----------------------------------------------------------------------*/
+#ifndef BME280_PRESSURE_32BIT
+    #define BME280_PRESSURE_32BIT         1
+#endif
+/*=========================================================================*/
+
 /*=========================================================================
     I2C ADDRESS/BITS
     -----------------------------------------------------------------------*/
     #define BME280_ADDRESS                (0x77)
+    #define BME280_CHIPID                 (0x60)
 /*=========================================================================*/
 
 /*=========================================================================
@@ -66,6 +79,7 @@
       BME280_REGISTER_CAL26              = 0xE1,  // R calibration stored in 0xE1-0xF0
 
       BME280_REGISTER_CONTROLHUMID       = 0xF2,
+      BME280_REGISTER_STATUS             = 0xF3,
       BME280_REGISTER_CONTROL            = 0xF4,
       BME280_REGISTER_CONFIG             = 0xF5,
       BME280_REGISTER_PRESSUREDATA       = 0xF7,
@@ -103,21 +117,120 @@
     } bme280_calib_data;
 /*=========================================================================*/
 
+/*=========================================================================
+    MEASUREMENT SETTINGS
+    -----------------------------------------------------------------------*/
+    enum bme280_sampling
+    {
+      BME280_SAMPLING_NONE               = 0x00,
+      BME280_SAMPLING_X1                 = 0x01,
+      BME280_SAMPLING_X2                 = 0x02,
+      BME280_SAMPLING_X4                 = 0x03,
+      BME280_SAMPLING_X8                 = 0x04,
+      BME280_SAMPLING_X16                = 0x05
+    };
+
+    enum bme280_mode
+    {
+      BME280_MODE_SLEEP                  = 0x00,
+      BME280_MODE_FORCED                 = 0x01,
+      BME280_MODE_NORMAL                 = 0x03
+    };
+
+    enum bme280_filter
+    {
+      BME280_FILTER_OFF                  = 0x00,
+      BME280_FILTER_X2                   = 0x01,
+      BME280_FILTER_X4                   = 0x02,
+      BME280_FILTER_X8                   = 0x03,
+      BME280_FILTER_X16                  = 0x04
+    };
+
+    enum bme280_standby
+    {
+      BME280_STANDBY_MS_0_5              = 0x00,
+      BME280_STANDBY_MS_62_5             = 0x01,
+      BME280_STANDBY_MS_125              = 0x02,
+      BME280_STANDBY_MS_250              = 0x03,
+      BME280_STANDBY_MS_500              = 0x04,
+      BME280_STANDBY_MS_1000             = 0x05,
+      BME280_STANDBY_MS_10               = 0x06,
+      BME280_STANDBY_MS_20               = 0x07
+    };
+
+    // Recommended modes of operation (DS 3.5)
+    enum bme280_profile
+    {
+      BME280_PROFILE_WEATHER_MONITORING,
+      BME280_PROFILE_HUMIDITY_SENSING,
+      BME280_PROFILE_INDOOR_NAVIGATION,
+      BME280_PROFILE_GAMING
+    };
+
+    typedef struct
+    {
+      bme280_mode     mode;
+      bme280_sampling osrs_t;
+      bme280_sampling osrs_p;
+      bme280_sampling osrs_h;
+      bme280_filter   filter;
+      bme280_standby  standby;
+    } bme280_settings;
+/*=========================================================================*/
+
+/*=========================================================================
+    SAMPLE DATA
+    -----------------------------------------------------------------------*/
+    typedef struct
+    {
+      float temperature;    // degrees C
+      float pressure;       // Pa
+      float humidity;       // %RH
+    } bme280_sample;
+
+    typedef struct
+    {
+      int32_t  temperature; // 0.01 degrees C
+      uint32_t pressure;    // Pa
+      uint32_t humidity;    // %RH as Q22.10
+    } bme280_sample_fixed;
+/*=========================================================================*/
+
 
 
 class BME280
 {
   public:
 
+    BME280(void);
+    void  setCalibrationCache(int address);
     bool  begin(uint8_t addr = BME280_ADDRESS);
+    void  setSampling(const bme280_settings &settings);
+    void  setProfile(bme280_profile profile);
+    bool  measure(void);
+    uint16_t measurementTime(void);
+    bme280_sample readAll(void);
+    bool  readAllFixed(bme280_sample_fixed &sample);
     float temperature(void);
     float pressure(void);
     float humidity(void);
     float altitude(float seaLevel);
 
+    static int16_t  fahrenheitX100(int32_t centiCelsius);
+    static uint16_t inHgX100(uint32_t pascals);
+    static uint16_t humidityX100(uint32_t humidityQ22_10);
+
   private:
 
     void readCoefficients(void);
+    bool readRaw(int32_t *adc_T, int32_t *adc_P, int32_t *adc_H);
+    bool loadCoefficients(void);
+    void saveCoefficients(void);
+    uint8_t coefficientsChecksum(void);
+
+    int32_t   compensateTemperature(int32_t adc_T);
+    uint32_t  compensatePressure(int32_t adc_P);
+    uint32_t  compensateHumidity(int32_t adc_H);
 
     void      write8(byte reg, byte value);
     uint8_t   read8(byte reg);
@@ -126,11 +239,15 @@ class BME280
     int16_t   readS16(byte reg);
     uint16_t  read16_LE(byte reg); // little endian
     int16_t   readS16_LE(byte reg); // little endian
+    void      readBurst(byte reg, uint8_t *buffer, uint8_t length);
 
     uint8_t   _i2caddr;
     int32_t   _sensorID;
+    int       _cacheAddress;
     int32_t t_fine;
 
+    bme280_settings _settings;
+
     bme280_calib_data _bme280_calib;
 
 };
@@ -26,55 +26,183 @@
 ******************************************************************************/
 
 #include "CAT9555.h"
+#include "I2CStats.h"
 #include <Wire.h>
 
 #ifdef __SAM3X8E__
 #define Wire Wire1
 #endif
 
+// Set from the INT pin change interrupt, cleared by update()
+static volatile bool intPending = false;
+static volatile unsigned long intTime = 0;
+static uint8_t intPinNumber;
+
+static void onInterrupt()
+{
+	if (::digitalRead(intPinNumber) == HIGH)
+		return;		// INT released after the inputs were read
+	if (!intPending)
+		intTime = millis();
+	intPending = true;
+}
+
 // CONSTRUCTUR
 CAT9555::CAT9555(uint8_t addr)
 {
 	address = addr; // Store address into private variable
+	capture = false;
+	eventHead = 0;
+	eventTail = 0;
 }
 
 void CAT9555::begin(){
 
 	writeRegister(CONFIG_PORT0, 0x0E);	// setup direction register port0
 	writeRegister(CONFIG_PORT1, 0x7F);	// setup direction register port1
-	writeRegister(OUTPUT_PORT0, 0x3c);	// set all output pin to LOW level
+	outputs = 0x3CFF;					// set all output pin to LOW level (port1 at its power-on value)
+	write_16_Register(OUTPUT_PORT0, outputs);
 
 }
 
 void CAT9555::digitalWrite(int PIN, int data){
 
-	uint8_t data_reg = read_8_Register(INPUT_PORT0);
-	if (data == HIGH )
-		if (PIN == LED1 || PIN == LED2)
-      		data_reg = ~PIN >> 8 & data_reg;
-    	else
-    		data_reg = PIN >> 8 | data_reg;
-    else if (data == LOW)
-    	if (PIN == LED1 || PIN == LED2)
-    		data_reg = PIN >> 8 | data_reg;
-    	else
-    		data_reg = (0xFF ^ PIN >> 8) &  data_reg;
-    writeRegister(OUTPUT_PORT0, data_reg);
-    data_reg = read_8_Register(INPUT_PORT0);
+	writePins(PIN, data == HIGH ? PIN : 0);
+
+}
+
+// WRITE PINS
+// Sets every pin in mask to the level of the same bit in values (HIGH = on for the LEDs)
+// in a single transaction. The output state is kept in a shadow register so nothing is read back.
+void CAT9555::writePins(uint16_t mask, uint16_t values){
+
+	uint16_t data = (outputs & ~mask) | ((values ^ ACTIVE_LOW_PINS) & mask);
+	uint16_t changed = data ^ outputs;
+	outputs = data;
+
+	if ((changed & 0xFF00) && (changed & 0x00FF))
+		write_16_Register(OUTPUT_PORT0, data);
+	else if (changed & 0xFF00)
+		writeRegister(OUTPUT_PORT0, data >> 8);
+	else if (changed & 0x00FF)
+		writeRegister(OUTPUT_PORT1, data & 0xFF);
 
 }
 
 int CAT9555::digitalRead(int PIN){
 
-	uint16_t data = read_16_Register(INPUT_PORT0);
-	//Serial.println(data,BIN);
-	int result = (data ^ 0x30FF) & PIN;  //0xFFFF
+	uint16_t data = capture ? stable : readInputs();
+	int result = data & PIN;
 	if (result)
 		return HIGH;
 	else
 		return result;
 	
 }
+
+// LOGICAL INPUT LEVELS (buttons and joystick are active low)
+uint16_t CAT9555::readInputs()
+{
+	uint16_t data = read_16_Register(INPUT_PORT0);
+	//Serial.println(data,BIN);
+	return data ^ 0x30FF;  //0xFFFF
+}
+
+// ENABLE INPUT CAPTURE
+// The open drain INT output is asserted when any input changes and released when the port is read,
+// so the inputs are only read after a change. digitalRead() then returns the debounced snapshot.
+// Both edges are sensed because a pin that is not fully asynchronous cannot wake the CPU from
+// standby on a falling edge alone (a missed edge would leave INT asserted for good).
+void CAT9555::enableInputCapture(uint8_t intPin)
+{
+	stable = sampled = readInputs();
+	debouncing = false;
+	intPending = false;
+	intPinNumber = intPin;
+	capture = true;
+	pinMode(intPin, INPUT_PULLUP);
+	attachInterrupt(digitalPinToInterrupt(intPin), onInterrupt, CHANGE);
+}
+
+// PENDING
+// True while a change still has to be read or debounced (the debounce is timed with millis()).
+bool CAT9555::pending()
+{
+	return capture && (intPending || debouncing);
+}
+
+// UPDATE
+// Call from loop(): reads the ports once per INT and queues an event for every input that stayed
+// at its new level for DEBOUNCE_MS.
+void CAT9555::update()
+{
+	if (!capture)
+		return;
+
+	if (intPending)
+	{
+		noInterrupts();
+		unsigned long time = intTime;
+		intPending = false;
+		interrupts();
+
+		uint16_t data = readInputs();
+		if (data != sampled)
+		{
+			sampled = data;
+			changed = time;
+			debouncing = true;
+		}
+	}
+
+	if (debouncing && millis() - changed >= DEBOUNCE_MS)
+	{
+		debouncing = false;
+		uint16_t edges = (sampled ^ stable) & EVENT_PINS;
+		stable = sampled;
+		for (uint16_t pin = 1; edges; pin <<= 1)
+		{
+			if (edges & pin)
+			{
+				pushEvent(pin, (stable & pin) ? HIGH : LOW, changed);
+				edges &= ~pin;
+			}
+		}
+	}
+}
+
+// DEBOUNCED INPUT SNAPSHOT
+uint16_t CAT9555::inputs()
+{
+	return capture ? stable : readInputs();
+}
+
+// EVENT QUEUE
+// Single producer, single consumer ring buffer: only the producer moves eventHead and only the
+// consumer moves eventTail, so no locking is needed. Events are dropped when the queue is full.
+// The producer is update() in the main context, not the INT interrupt: the ports can only be read
+// over I2C, which must not run in an ISR, so onInterrupt() just records when the change happened.
+void CAT9555::pushEvent(uint16_t pin, uint8_t level, unsigned long time)
+{
+	uint8_t head = eventHead;
+	uint8_t next = (head + 1) & (EVENT_QUEUE_SIZE - 1);
+	if (next == eventTail)
+		return;
+	events[head].pin = pin;
+	events[head].level = level;
+	events[head].time = time;
+	eventHead = next;
+}
+
+bool CAT9555::readEvent(cat9555_event &event)
+{
+	uint8_t tail = eventTail;
+	if (tail == eventHead)
+		return false;
+	event = events[tail];
+	eventTail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);
+	return true;
+}
 // WRITE REGISTER
 void CAT9555::writeRegister(int reg, int data)
 {
@@ -83,12 +211,24 @@ void CAT9555::writeRegister(int reg, int data)
     Wire.write(reg); 
     Wire.write(data); 
     Wire.endTransmission(); 
+    I2C_STATS_WRITE(1);
 }
 
+// WRITE REGISTER PAIR (port0 from the high byte, port1 from the low byte)
+void CAT9555::write_16_Register(int reg, uint16_t data)
+{
+
+    Wire.beginTransmission(address);  
+    Wire.write(reg); 
+    Wire.write(data >> 8); 
+    Wire.write(data & 0xFF); 
+    Wire.endTransmission(); 
+    I2C_STATS_WRITE(2);
+}
 
 uint8_t CAT9555::read_8_Register(int reg)
 {
-	uint8_t _data0;
+	uint8_t _data0 = 0xFF;	// Power-on value of the registers if the CAT9555 does not answer
 	Wire.beginTransmission(address);
 	Wire.write(reg);
 	Wire.endTransmission();  
@@ -96,12 +236,13 @@ uint8_t CAT9555::read_8_Register(int reg)
 	if(Wire.available()) {
 		_data0 = Wire.read();
 	}
+	I2C_STATS_READ(1);
 	return _data0;
 }
 // READ REGISTER
 uint16_t CAT9555::read_16_Register(int reg)
 {
-	uint16_t _data0;
+	uint16_t _data0 = 0xFFFF;	// Power-on value of the registers if the CAT9555 does not answer
 	Wire.beginTransmission(address);
 	Wire.write(reg);
 	Wire.endTransmission();  
@@ -112,6 +253,7 @@ uint16_t CAT9555::read_16_Register(int reg)
 	if(Wire.available()) {
 		_data0 |= Wire.read();
 	}
+	I2C_STATS_READ(2);
 
 	return _data0;
 }
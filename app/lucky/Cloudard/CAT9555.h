@@ -65,6 +65,26 @@
 #define PB2 		(uint8_t)0x40     //reg1
 #define	OLEDR		(uint8_t)0x80	    //reg1
 
+// Outputs that are lit by driving the pin LOW
+#define	ACTIVE_LOW_PINS		(uint16_t)(LED1 | LED2)
+
+// Inputs reported as edge events by the input capture
+#define	EVENT_PINS			(uint16_t)(PIR | JOYL | JOYR | JOYU | JOYD | JOYC | PB1 | PB2)
+
+///////////////////////////////////
+// CAT9555 Input Capture         //
+///////////////////////////////////
+
+#define	DEBOUNCE_MS			20		// inputs must be stable this long before an edge is reported
+#define	EVENT_QUEUE_SIZE	8		// must be a power of 2
+
+typedef struct
+{
+	uint16_t pin;			// one of the EVENT_PINS
+	uint8_t level;			// HIGH when pressed or motion detected
+	unsigned long time;		// millis() when the change was signalled on INT
+} cat9555_event;
+
 ////////////////////////////////
 // CAT9555 Class Declaration  //
 ////////////////////////////////
@@ -75,10 +95,28 @@ public:
 	void begin();
 	int digitalRead(int pin);
 	void digitalWrite(int pin, int value);
+	void writePins(uint16_t mask, uint16_t values);
+	void enableInputCapture(uint8_t intPin);
+	void update();
+	bool pending();
+	bool readEvent(cat9555_event &event);
+	uint16_t inputs();
 
 private:
 	byte address;
+	uint16_t outputs;	// shadow of OUTPUT_PORT0 (high byte) and OUTPUT_PORT1 (low byte)
+	bool capture;		// inputs are read on INT instead of on every digitalRead()
+	uint16_t stable;	// debounced logical input levels
+	uint16_t sampled;	// last logical input levels read from the device
+	unsigned long changed;	// millis() of the last change in sampled
+	bool debouncing;
+	cat9555_event events[EVENT_QUEUE_SIZE];
+	volatile uint8_t eventHead;
+	volatile uint8_t eventTail;
+	uint16_t readInputs();
+	void pushEvent(uint16_t pin, uint8_t level, unsigned long time);
 	void writeRegister(int reg, int data);
+	void write_16_Register(int reg, uint16_t data);
 	uint8_t read_8_Register(int reg);
 	uint16_t read_16_Register(int reg);
 };
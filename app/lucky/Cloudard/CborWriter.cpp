@@ -0,0 +1,78 @@
+#include "CborWriter.h"
+
+// CBOR major types
+#define CBOR_UNSIGNED   0
+#define CBOR_NEGATIVE   1
+#define CBOR_ARRAY      4
+#define CBOR_MAP        5
+
+/*!
+ *  @brief  Create a writer
+ *  @param  out the Print the CBOR is written to
+ */
+CborWriter::CborWriter(Print &out) : out(out) {}
+
+/*!
+ *  @brief  Start a definite length array, the next count items written are its members
+ *  @param  count number of members
+ */
+void CborWriter::array(uint16_t count)
+{
+  head(CBOR_ARRAY, count);
+}
+
+/*!
+ *  @brief  Start a definite length map, the next count pairs of items written are its keys and values
+ *  @param  count number of key value pairs
+ */
+void CborWriter::map(uint16_t count)
+{
+  head(CBOR_MAP, count);
+}
+
+/*!
+ *  @brief  Write an integer in the shortest encoding
+ *  @param  value the value
+ */
+void CborWriter::integer(long value)
+{
+  if(value < 0)
+    head(CBOR_NEGATIVE, -1 - value);
+  else
+    head(CBOR_UNSIGNED, value);
+}
+
+void CborWriter::head(uint8_t major, uint32_t value)
+{
+  uint8_t buffer[5];
+  uint8_t length;
+  major <<= 5;
+  if(value < 24)
+  {
+    buffer[0] = major | value;
+    length = 1;
+  }
+  else if(value <= 0xFF)
+  {
+    buffer[0] = major | 24;
+    buffer[1] = value;
+    length = 2;
+  }
+  else if(value <= 0xFFFF)
+  {
+    buffer[0] = major | 25;
+    buffer[1] = value >> 8;
+    buffer[2] = value;
+    length = 3;
+  }
+  else
+  {
+    buffer[0] = major | 26;
+    buffer[1] = value >> 24;
+    buffer[2] = value >> 16;
+    buffer[3] = value >> 8;
+    buffer[4] = value;
+    length = 5;
+  }
+  out.write(buffer, length);
+}
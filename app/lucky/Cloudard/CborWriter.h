@@ -0,0 +1,30 @@
+/**
+ * NAME: CborWriter.h
+ * DESCRIPTION: Header file for the streaming CBOR (RFC 7049) writer that encodes directly to any Print without using the heap.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef CborWriter_h
+#define CborWriter_h
+
+#include <Arduino.h>
+
+class CborWriter
+{
+  public:
+    CborWriter(Print &out);
+    void array(uint16_t count);
+    void map(uint16_t count);
+    void integer(long value);
+
+  private:
+    Print &out;
+
+    void head(uint8_t major, uint32_t value);
+};
+
+#endif
@@ -11,152 +11,721 @@
  */
 #include "Lucky.h"
 #include <WiFiNINA.h>
+#include <utility/wifi_drv.h>
 #include <HttpClient.h>
-#include <ArduinoJson.h>
 #include <ArduinoLog.h>
+#include "LogBuffer.h"
 #include <avr/interrupt.h>
 #include <avr/wdt.h>
 #include <EEPROM.h>
 #include "AccessPoint.h"
+#include "EepromLayout.h"
+#include "I2CStats.h"
+#include "Scheduler.h"
+#include "Dispatcher.h"
+#include "ConnectionPool.h"
+#include "SampleBuffer.h"
+#include "SampleStats.h"
+#include "ReportPolicy.h"
+#include "LowPower.h"
+#include "Metrics.h"
+#include "PostQueue.h"
+#include "JsonWriter.h"
+#include "CborWriter.h"
+#include "DisplayLink.h"
+#include "LedDisplay.h"
 #include "Cloudard.h"
 
 // Set this to true if using remote LED Dispaly over Wifi
 #define HAS_LCD true
 
+// Set this to the view shown on the remote LED Display (DISPLAY_VIEW_LEDS for the POST status or DISPLAY_VIEW_CHART for the sensor data history)
+#define REMOTE_DISPLAY_VIEW DISPLAY_VIEW_CHART
+
 // Set this to true to send REST API request to local development server
 #define DEV_ENV false
 
 // Set this to the number of seconds that the Watch Dog will use before reseting the Arduino
 #define WATCH_DOG_SECONDS 600
 
+// Set this to the Arduino pin wired to the CAT9555 INT output on the Lucky Shield
+#define GPIO_INT_PIN 2
+
+// Set this to the number of seconds between sensor samples (the reporting policy stretches it while the sensor data is stable)
+#ifndef SAMPLE_TIME_SECS
+#define SAMPLE_TIME_SECS 60
+#endif
+
+// Set this to the number of seconds between sensor reads (the reads between two samples are filtered and aggregated)
+#ifndef SAMPLE_READ_SECS
+#define SAMPLE_READ_SECS 10
+#endif
+
+// Set this to true to sample the mean of the sensor reads since the last sample else the last (filtered) sensor read
+#define SAMPLE_AGGREGATE true
+
+// Set this to true to only POST samples that moved out of their deadband or a heartbeat, and to sample less often while the sensor data is stable (see ReportPolicy.h)
+#define REPORT_POLICY true
+
+// Set this to true to sleep between the passes of the Task Scheduler and put the NINA module in its low power mode between uploads (see LowPower.h)
+#define LOW_POWER true
+
+// Set this to the number of POSTs of new samples between two POSTs that carry a summary of the timing metrics (0 never attaches them, see Metrics.h)
+#ifndef METRICS_UPLOAD_POSTS
+#define METRICS_UPLOAD_POSTS 60
+#endif
+
+// Serial commands (a single character): dump the timing metrics, clear the timing metrics
+#define SERIAL_COMMAND_METRICS 'm'
+#define SERIAL_COMMAND_CLEAR 'c'
+
+// Set this to the number of samples to upload in a single POST (1 POSTs each sample as a single JSON object)
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 1
+#endif
+
+// Set this to the number of seconds a sample may wait in the buffer before a partial batch is POSTed
+#ifndef BATCH_MAX_AGE_SECS
+#define BATCH_MAX_AGE_SECS 300
+#endif
+
+// Set this to the number of bytes of the Test API response that are logged
+#define TEST_RESPONSE_SIZE 64
+
+// Version of the CBOR payload schema (see writePostCBOR())
+#define CBOR_SCHEMA_VERSION 1
+
+// Version of the CBOR payload schema with the timing metrics appended (see writePostCBOR())
+#define CBOR_METRICS_SCHEMA_VERSION 2
+
+// Set this to the number of seconds between replays of the samples that were saved in EEPROM during a network outage
+#define QUEUE_REPLAY_SECS 5
+
+// Set this to the number of seconds to wait before replaying again after a replay failed on every REST endpoint
+#define QUEUE_RETRY_SECS 60
+
+// Set this to the number of seconds to wait between attempts to join the Wifi network again after the connection was lost
+#define WIFI_RETRY_SECS 30
+
+// Largest SSID (32 characters) and WPA Password (63 characters) plus their terminators, the Configuration Settings must also fit in EEPROM_CONFIG_SIZE
+#define CONFIG_SSID_SIZE 33
+#define CONFIG_PASS_SIZE 64
+
+// Default REST Endpoints to POST the sensor data to (all of them are POSTed to concurrently), kept in flash and overridden from the Configuration Page
+const char workshopAuth[] PROGMEM = "Q2xvdWRXb3Jrc2hvcDpkR1Z6ZEhSbGMzUT0=";     // CloudWorkshop:dGVzdHRlc3Q=
+#if DEV_ENV == true
+const char devHost[] PROGMEM = "10.0.1.101";
+const char devPath[] PROGMEM = "/cloudservices/rest/weather/save";
+const endpoint_default defaultEndpoints[] PROGMEM =
+{
+  { devHost, devPath, workshopAuth, 8080, PAYLOAD_JSON },
+};
+#else
+const char herokuHost[] PROGMEM = "mark-servicesapp.herokuapp.com";
+const char azureHost[] PROGMEM = "markwsserve2.azurewebsites.net";
+const char awsHost[] PROGMEM = "services-app.us-east-2.elasticbeanstalk.com";
+const char googleHost[] PROGMEM = "cloud-workshop-services.appspot.com";
+const char restPath[] PROGMEM = "/rest/weather/save";
+const char cloudServicesPath[] PROGMEM = "/cloudservices/rest/weather/save";
+const endpoint_default defaultEndpoints[] PROGMEM =
+{
+  { herokuHost, restPath, workshopAuth, 80, PAYLOAD_JSON },             // Heroku
+  { azureHost, cloudServicesPath, workshopAuth, 80, PAYLOAD_JSON },     // Azure
+  { awsHost, restPath, workshopAuth, 80, PAYLOAD_JSON },                // AWS
+  { googleHost, restPath, workshopAuth, 80, PAYLOAD_JSON },             // Google
+};
+#endif
+static_assert(ENDPOINT_SLOTS <= QUEUE_MAX_ENDPOINTS, "Too many REST endpoints for the store-and-forward queue");
+
 WiFiClient wifi;
 WiFiSSLClient wifiSecure;
-WiFiClient remoteLedClient;
-char ssid[] = SECRET_SSID;        
-char pass[] = SECRET_PASS;    
+char ssid[CONFIG_SSID_SIZE] = SECRET_SSID;        
+char pass[CONFIG_PASS_SIZE] = SECRET_PASS;    
 int postCount = 0;   
 char ledDisplayAddress[] = "000.000.000.000";
 int ledDisplayPort = 8081;
 bool wdEnable = true;
+volatile bool wdExpired = false;
 volatile int wdSecCount = WATCH_DOG_SECONDS;
+sample_stats temperatureStats;
+sample_stats pressureStats;
+sample_stats humidityStats;
+queued_sample postSamples[BATCH_SIZE];
+bool postTimestamps = false;
+bool postMetrics = false;
+int metricsPostCount = 0;
+bool postPending = false;
+uint8_t postSampleCount = 0;
+uint32_t postSampleTicks = 0;
+int postReplaySlot = -1;
+uint8_t postReplayMask = 0;
+uint32_t replayDeadline = 0;
+bool wifiReconnecting = false;
+uint32_t wifiRetryDeadline = 0;
+int postErrorCount = 0;
+bool displayPending = false;
+bool displayConnected = false;
+
+// Cooperative tasks (sampling stays on a fixed cadence however long the network takes)
+void watchdogTask();
+void readTask();
+void sampleTask();
+void postTask();
+void displayTask();
+void inputTask();
+scheduler_task tasks[] =
+{
+  { watchdogTask, SECONDS_TO_TICKS(1), SECONDS_TO_TICKS(1) },
+  { readTask, SECONDS_TO_TICKS(SAMPLE_READ_SECS), SECONDS_TO_TICKS(1) },
+  { sampleTask, SECONDS_TO_TICKS(SAMPLE_TIME_SECS), SECONDS_TO_TICKS(1) },
+  { postTask, 0, 0 },
+  { displayTask, 0, 0 },
+  { inputTask, 0, 0 },
+};
+#define TASK_COUNT (sizeof(tasks) / sizeof(tasks[0]))
 
 /**
  * NAME: setup()
  * DESCRIPTION: Arduino Entry Point for setting up the application:
  * PROCESS:       Initialize Luck Shield
+ *                Set the sensor to the Weather Monitoring profile and enable input capture
  *                Display Welcome Message
  *                Initialize Logger
  *                Initialize the LED Display
+ *                Read the Configuration Settings, the store-and-forward queue, and the REST Endpoints from EEPROM
  *                Connect to the Wifi Network
+ *                Start the RTC and the Task Scheduler
+ *                Start the timing metrics and the low power sleep
  * INPUTS: None
  * OUTPUTS: None
  * 
  */
 void setup() 
 {
-  // Initialize the System
+  // Initialize the System (sensor calibration is cached in EEPROM) and take one forced mode sensor conversion per sample
+  i2cStatsReset();
+  lucky.environment().setCalibrationCache(EEPROM_CALIBRATION_ADDRESS);
   lucky.begin();
+  lucky.environment().setProfile(BME280_PROFILE_WEATHER_MONITORING);
+  lucky.gpio().enableInputCapture(GPIO_INT_PIN);
   Serial.begin(9600);
   while(!Serial);
 
-  // Initialize the Logger
-  Log.begin(LOG_LEVEL_VERBOSE, &Serial);
+  // Initialize the Logger (the log is kept in RAM and drained to Serial on every pass of the scheduler so logging never waits for the 9600 baud port)
+  logBuffer.begin(Serial);
+  Log.begin(LOG_COMPILED_LEVEL, &logBuffer);
 
   // Display application startup message
-  Log.notice(F("IoT Weather Station v0.1\n\n"));
+  LOG_NOTICE(F("IoT Weather Station v0.1\n\n"));
+  logI2CStats(F("lucky.begin()"));
+
+  // Start the sensor read statistics and the reporting policy
+  statsBegin(&temperatureStats);
+  statsBegin(&pressureStats);
+  statsBegin(&humidityStats);
+  reportBegin(SAMPLE_TIME_SECS);
 
   // Clear LED display
   postCount = 0;
   displayLED(postCount);
+  logI2CStats(F("displayLED()"));
 
   // Read Configuration Settings from EEPROM
   bool ok = readConfiguration();
 
+  // Continue the store-and-forward queue of samples that were not POSTed before the reset
+  postQueueBegin();
+  LOG_VERBOSE(F("%d samples waiting to be replayed\n"), postQueueCount());
+
+  // Load the REST Endpoints (the Configuration Page can change them)
+  endpointsBegin(defaultEndpoints, sizeof(defaultEndpoints) / sizeof(defaultEndpoints[0]));
+
   // Check for Network Configuration Page
   configurationStartupCheck(ok ? false : true);
 
   // Initialize and connect to WiFi module
   connectToWifi();
 
-  // Initialize the RTC and internal Watch Dog counter
+  // Start the persistent connection to the Remote LED Display
+#if HAS_LCD == true
+  displayLinkBegin(ledDisplayAddress, ledDisplayPort);
+#endif
+
+  // Initialize the RTC and internal Watch Dog counter and start the tasks
   wdEnable = true;
   wdSecCount = WATCH_DOG_SECONDS;
   initRTC();
+  schedulerStart(tasks, TASK_COUNT);
+#if METRICS
+  metricsBegin();
+#endif
+#if LOW_POWER == true
+  powerBegin();
+#endif
 }
 
 /**
  * NAME: loop()
  * DESCRIPTION: Arduino Entry Point for the application:
  * PROCESS:       Loop Forever
- *                  Get the temperature, pressure, and humidity sensor data
- *                  Convert the sensor data to JSON
- *                  Log the sensor data   
- *                  POST the sensor data to the REST endpoints
- *                  Update the LED Display
- *                  Sleep
+ *                  Run the tasks that are due:
+ *                    Watch Dog task resets the Watch Dog every second
+ *                    Read task reads the sensor every SAMPLE_READ_SECS and updates the statistics of the sample window
+ *                    Sample task takes the sensor data from the statistics every SAMPLE_TIME_SECS and buffers it until a batch is ready
+ *                    Post task drives the concurrent POSTs of the sensor data to the REST endpoints (replaying any samples missed during an outage first)
+ *                    Display task updates the LED Displays once all the POSTs are done and keeps the Remote LED Display connection open
+ *                    Input task processes the Lucky Shield input events and the Serial commands
+ *                  Send as much of the log as the Serial transmit buffer takes
+ *                  Sleep until the next interrupt (IDLE while the POSTs, the Remote LED Display, or the input debounce need millis() else standby until the next RTC tick)
  * INPUTS: None
  * OUTPUTS: None
  * 
  */
 void loop() 
 {
-  // Enable and reset Watch Dog while we are in the processing loop (minus the wait())
-  wdEnable = true;
+  schedulerRun(tasks, TASK_COUNT);
+  logBuffer.drain();
+#if LOW_POWER == true
+  powerSleep(postPending || displayLinkBusy() || lucky.gpio().pending());
+#endif
+}
+
+/**
+ * NAME: watchdogTask()
+ * DESCRIPTION: Task to reset the Watch Dog, if the scheduler stops running tasks for WATCH_DOG_SECONDS the Arduino is reset.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void watchdogTask()
+{
+  noInterrupts();
   wdSecCount = WATCH_DOG_SECONDS;
-  
+  interrupts();
+}
+
+/**
+ * NAME: readTask()
+ * DESCRIPTION: Task to read the sensor between samples and add the reads to the statistics of the current sample window.
+ * PROCESS:   Get the temperature, pressure, and humidity sensor data in hundredths from a single sensor read
+ *            Add each value to its statistics (median outlier filter, minimum, maximum, mean, and variance)
+ *            Skip the read if the sensor conversion timed out (the sensor still holds the previous result)
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void readTask()
+{
+  i2cStatsReset();
+  uint32_t probe = METRICS_START();
+  bme280_sample_fixed sample;
+  bool ok = lucky.environment().readAllFixed(sample);
+  METRICS_RECORD(METRIC_READ, probe);
+  logI2CStats(F("readAllFixed()"));
+  if(!ok)
+  {
+    LOG_ERROR(F("Sensor conversion timed out, read skipped\n"));
+    return;
+  }
+  statsAdd(&temperatureStats, BME280::fahrenheitX100(sample.temperature));
+  statsAdd(&pressureStats, BME280::inHgX100(sample.pressure));
+  statsAdd(&humidityStats, BME280::humidityX100(sample.humidity));
+}
+
+/**
+ * NAME: sampleTask()
+ * DESCRIPTION: Task to close the sample window and buffer the sensor data until the Post task POSTs it to the REST endpoints.
+ * PROCESS:   Read the sensor if there has not been a read in the window yet (skip the sample if the sensor could not be read)
+ *            Take the mean of the window (or the last filtered read if SAMPLE_AGGREGATE is false) and log the window statistics
+ *            Start the next window
+ *            Let the reporting policy suppress the sample and set the time of the next sample
+ *            Add the sensor data to the Sample Buffer (the oldest sample is dropped if the buffer is full)
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void sampleTask()
+{
   // For debugging display Free RAM
-  Log.verbose(F("Free RAM is %d\n"), freeRam());          
+  LOG_VERBOSE(F("Free RAM is %d\n"), freeRam());          
+#if LOW_POWER == true
+  uint16_t asleep = powerAsleepPermille();
+  uint16_t standby = powerStandbyPermille();
+  LOG_VERBOSE(F("CPU asleep %d.%d percent of the time (%d.%d percent in standby)\n"), asleep / 10, asleep % 10, standby / 10, standby % 10);
+#endif
   
-  // Get current temperature, pressure, and humidity
-  float temperature = (lucky.environment().temperature() * 9/5) + 32;
-  float pressure = (lucky.environment().pressure() / 100.0F) / 33.8638F;
-  float humidity = lucky.environment().humidity();
+  // Get current temperature (F), pressure (inHg), and humidity (%) in hundredths from the reads in the window
+  if(temperatureStats.count == 0)
+    readTask();
+  if(temperatureStats.count == 0)
+  {
+    LOG_ERROR(F("No sensor data in the sample window, sample skipped\n"));
+    return;
+  }
+  weather_sample buffered;
+  buffered.ticks = schedulerTicks();
+#if SAMPLE_AGGREGATE == true
+  buffered.temperature = statsMean(&temperatureStats);
+  buffered.pressure = statsMean(&pressureStats);
+  buffered.humidity = statsMean(&humidityStats);
+#else
+  buffered.temperature = temperatureStats.last;
+  buffered.pressure = pressureStats.last;
+  buffered.humidity = humidityStats.last;
+#endif
+  logSampleStats(F("Temperature"), &temperatureStats);
+  logSampleStats(F("Pressure"), &pressureStats);
+  logSampleStats(F("Humidity"), &humidityStats);
+  statsReset(&temperatureStats);
+  statsReset(&pressureStats);
+  statsReset(&humidityStats);
+
+  // Only POST significant changes and heartbeats, and take the next sample sooner while the sensor data is changing
+#if REPORT_POLICY == true
+  bool report = reportCheck(&buffered);
+  setSampleInterval(reportIntervalSecs());
+  if(!report)
+  {
+    const report_counts *counts = reportCounts();
+    LOG_VERBOSE(F("Sample suppressed (%d suppressed, %d changed, %d heartbeats), next sample in %d secs\n"), counts->suppressed, counts->changed, counts->heartbeats, reportIntervalSecs());
+    return;
+  }
+#endif
+  sampleBufferAdd(&buffered);
 
-  // Convert sensor data to JSON
-  String json = createJSON(temperature, pressure, humidity);
+  if(postPending)
+    LOG_VERBOSE(F("Previous POSTs still running, %d samples buffered\n"), sampleBufferCount());
+}
+
+/**
+ * NAME: setSampleInterval()
+ * DESCRIPTION: Utility method to change the time between runs of the Sample task (called from the Sample task, the next run is moved too).
+ * 
+ * INPUTS:
+ *    uint16_t secs   Seconds between samples
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void setSampleInterval(uint16_t secs)
+{
+  for(uint8_t i = 0;i < TASK_COUNT;++i)
+  {
+    if(tasks[i].run == sampleTask)
+    {
+      uint32_t period = SECONDS_TO_TICKS(secs);
+      tasks[i].due += period - tasks[i].period;
+      tasks[i].period = period;
+    }
+  }
+}
+
+/**
+ * NAME: postTask()
+ * DESCRIPTION: Task to drive the concurrent POSTs of the sensor data to the REST endpoints without blocking.
+ * PROCESS:   Rejoin the Wifi network when idle if the connection was lost
+ *            Start the next POSTs when idle (replaying the store-and-forward queue before new samples)
+ *            Otherwise refresh a cached REST endpoint address so the POSTs rarely wait for DNS
+ *            Advance every POST request
+ *            Once all REST Endpoints are done update the store-and-forward queue, count the errors, and start the Display task
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void postTask()
+{
+  if(!postPending)
+  {
+    pollWifi();
+    if(!startReplay() && batchReady())
+      startPost();
+    else if(!postPending)
+      poolRefresh();
+    return;
+  }
+  if(dispatchPoll())
+    return;
+
+  // All the REST Endpoints are done so find the ones that failed
+  uint8_t failed = 0;
+  for(int i = 0;i < ENDPOINT_SLOTS;++i)
+  {
+    int status = dispatchStatus(i);
+    if((status < 200 || status > 299) && status != DISPATCH_SKIPPED)
+    {
+      failed |= 1 << i;
+      ++postErrorCount;
+    }
+  }
+
+  // Update the store-and-forward queue with the samples that still have to be delivered
+  if(postReplaySlot >= 0)
+  {
+    postQueueDelivered(postReplaySlot, ~failed);
+    if(failed == postReplayMask)
+      replayDeadline = schedulerTicks() + SECONDS_TO_TICKS(QUEUE_RETRY_SECS);
+    postReplaySlot = -1;
+  }
+  else
+  {
+    if(failed != 0)
+      queueSamples(postSampleCount, failed);
+    sampleBufferRemoveThrough(postSampleTicks);
+    postSampleCount = 0;
+  }
+  postPending = false;
+  displayPending = true;
+}
+
+/**
+ * NAME: batchReady()
+ * DESCRIPTION: Utility method to check if the Sample Buffer should be POSTed.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True if BATCH_SIZE samples are buffered or the oldest sample is older than BATCH_MAX_AGE_SECS
+ *    
+ */
+bool batchReady()
+{
+  const weather_sample *oldest = sampleBufferPeek(0);
+  if(oldest == NULL)
+    return false;
+  return sampleBufferCount() >= BATCH_SIZE || schedulerTicks() - oldest->ticks >= SECONDS_TO_TICKS(BATCH_MAX_AGE_SECS);
+}
+
+/**
+ * NAME: startPost()
+ * DESCRIPTION: Utility method to start POSTing the oldest samples in the Sample Buffer to the REST endpoints.
+ * PROCESS:   Take up to BATCH_SIZE samples (sent as a single JSON object if BATCH_SIZE is 1 else as an array)
+ *            Send the samples to the chart on the Remote LED Display
+ *            Log the sensor data   
+ *            Take a snapshot of the timing metrics every METRICS_UPLOAD_POSTS POSTs to attach to the payload
+ *            Start the concurrent POSTs
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void startPost()
+{
+  // Take the samples to POST out of the Sample Buffer (only batches are stamped with the time they were taken)
+  unsigned long now = WiFi.getTime();
+  postSampleCount = min(sampleBufferCount(), (uint8_t)BATCH_SIZE);
+  for(uint8_t i = 0;i < postSampleCount;++i)
+  {
+    const weather_sample *sample = sampleBufferPeek(i);
+    postSamples[i].timestamp = sampleTimestamp(sample, now);
+    postSamples[i].temperature = sample->temperature;
+    postSamples[i].pressure = sample->pressure;
+    postSamples[i].humidity = sample->humidity;
+    postSampleTicks = sample->ticks;
+  }
+  postTimestamps = BATCH_SIZE > 1;
+  postMetrics = false;
+
+  // Add the samples to the chart on the Remote LED Display
+#if HAS_LCD == true
+  sendDisplayHistory();
+#endif
 
   // Print sensor data as JSON to the Verbose Logger
-  Log.verbose(F("Generated JSON sensor data: %s\n"), json.c_str());
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_VERBOSE
+  LOG_VERBOSE(F("Generated JSON sensor data: "));
+  writePostJSON(logBuffer);
+  logBuffer.println();
+#endif
+
+  // Periodically attach the timing metrics (a snapshot, the body is written again for every REST endpoint)
+#if METRICS && METRICS_UPLOAD_POSTS > 0
+  postMetrics = ++metricsPostCount >= METRICS_UPLOAD_POSTS;
+  if(postMetrics)
+  {
+    metricsPostCount = 0;
+    metricsSnapshot();
+  }
+#endif
+
+#if DEV_ENV == true
+  if(endpointGet(0) != NULL)
+    testEndpoint(endpointGet(0)->host, "/cloudservices/rest/weather/get/1/6", endpointGet(0)->port);
+#endif
+
+  // Start POSTing to all the REST Endpoints concurrently
+  postErrorCount = 0;
+  postPending = dispatchStart(endpointsEnabled(), BATCH_SIZE > 1, writePostBody);
+  if(!postPending)
+  {
+    postSampleCount = 0;
+    postMetrics = false;
+  }
+}
+
+/**
+ * NAME: pollWifi()
+ * DESCRIPTION: Utility method to rejoin the Wifi network after an outage without blocking the Post task.
+ * PROCESS:   Once connected again replay the store-and-forward queue right away
+ *            Otherwise ask the WiFi module to join the network every WIFI_RETRY_SECS and let it connect in the background
+ *            (WiFi.begin() would block for up to 10 seconds)
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void pollWifi()
+{
+  if(WiFi.status() == WL_CONNECTED)
+  {
+    if(wifiReconnecting)
+    {
+      LOG_VERBOSE(F("Reconnected to Wifi\n"));
+      wifiReconnecting = false;
+      replayDeadline = schedulerTicks();
+    }
+    return;
+  }
+  if(wifiReconnecting && (int32_t)(schedulerTicks() - wifiRetryDeadline) < 0)
+    return;
+  LOG_VERBOSE(F("Lost connection to Wifi, attempting to connect to Network named: %s\n"), ssid);
+  WiFiDrv::wifiSetPassphrase(ssid, strlen(ssid), pass, strlen(pass));
+  wifiReconnecting = true;
+  wifiRetryDeadline = schedulerTicks() + SECONDS_TO_TICKS(WIFI_RETRY_SECS);
+}
+
+/**
+ * NAME: startReplay()
+ * DESCRIPTION: Utility method to replay the oldest sample in the store-and-forward queue to the REST endpoints that missed it.
+ * PROCESS:   Replay at most one sample every QUEUE_REPLAY_SECS (QUEUE_RETRY_SECS after a replay failed everywhere) so a 
+ *            long backlog does not flood the device or the REST endpoints
+ *            Only replay while connected to the Wifi network
+ *            Start the concurrent POSTs of the sample to the REST endpoints it still has to be delivered to
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True if a replay was started
+ *    
+ */
+bool startReplay()
+{
+  if((int32_t)(schedulerTicks() - replayDeadline) < 0)
+    return false;
+  replayDeadline = schedulerTicks() + SECONDS_TO_TICKS(QUEUE_REPLAY_SECS);
+  if(WiFi.status() != WL_CONNECTED)
+    return false;
+
+  // Get the oldest sample that still has to be delivered
+  postReplaySlot = postQueueNext(&postSamples[0], &postReplayMask);
+  if(postReplaySlot < 0)
+    return false;
+  postSampleCount = 1;
+  postTimestamps = true;
+  postMetrics = false;
 
-  // Make sure we are still connected to the Wifi network and if not connect back to the Wifi network
-  if(wifi.status() == WL_CONNECTION_LOST || wifi.status() == WL_DISCONNECTED)
+  // Print sensor data as JSON with the time it was taken to the Verbose Logger
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_VERBOSE
+  LOG_VERBOSE(F("Replaying queued JSON sensor data: "));
+  writePostJSON(logBuffer);
+  logBuffer.println();
+#endif
+
+  // Start POSTing to the REST Endpoints that missed the sample
+  postErrorCount = 0;
+  postPending = dispatchStart(postReplayMask, false, writePostBody);
+  if(!postPending)
   {
-    Log.verbose(F("Lost connection to Wifi"));
-    connectToWifi();  
+    postReplaySlot = -1;
+    postSampleCount = 0;
   }
+  return postPending;
+}
 
-  // POST the sensor data to all REST Endpoints
-  int errorCount = 0;
-  int status = 0;
-  #if DEV_ENV == true
-    String serverAddress = "10.0.1.101";
-    testEndpoint(serverAddress, "/cloudservices/rest/weather/get/1/6", 8080);
-    status = postToEndpoint(serverAddress, "/cloudservices/rest/weather/save", 8080, json);
-    if(status != 200)
-      ++errorCount;
-  #else
-    String serverAddress = "";
-    // Post to Heroku
-    serverAddress = "mark-servicesapp.herokuapp.com";
-    status = postToEndpoint(serverAddress, "/rest/weather/save", 80, json);
-    if(status != 200)
-      ++errorCount;
-    // Post to Azure
-    serverAddress = "markwsserve2.azurewebsites.net";
-    status = postToEndpoint(serverAddress, "/cloudservices/rest/weather/save", 80, json);
-    if(status != 200)
-      ++errorCount;
-    // Post to AWS
-    serverAddress = "services-app.us-east-2.elasticbeanstalk.com";
-    status = postToEndpoint(serverAddress, "/rest/weather/save", 80, json);
-    if(status != 200)
-      ++errorCount;
-    // Post to Google
-    serverAddress = "cloud-workshop-services.appspot.com";
-    status = postToEndpoint(serverAddress, "/rest/weather/save", 80, json);
-    if(status != 200)
-      ++errorCount;
-  #endif
+/**
+ * NAME: queueSamples()
+ * DESCRIPTION: Utility method to save the samples that were POSTed to the store-and-forward queue.
+ * 
+ * INPUTS:
+ *    uint8_t count     The number of samples to save
+ *    uint8_t pending   Bit mask of the REST Endpoints the samples still have to be delivered to
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void queueSamples(uint8_t count, uint8_t pending)
+{
+  for(uint8_t i = 0;i < count;++i)
+    postQueueAdd(&postSamples[i], pending);
+  LOG_VERBOSE(F("Queued %d samples, %d samples waiting to be replayed\n"), count, postQueueCount());
+}
+
+/**
+ * NAME: sampleTimestamp()
+ * DESCRIPTION: Utility method to get the time a buffered sample was taken.
+ * 
+ * INPUTS:
+ *    const weather_sample *sample    The sample
+ *    unsigned long now               The current time from the Wifi module
+ * OUTPUTS:
+ *    Epoch seconds when the sample was taken or 0 if the Wifi module does not know the time yet
+ *    
+ */
+unsigned long sampleTimestamp(const weather_sample *sample, unsigned long now)
+{
+  if(now == 0)
+    return 0;
+  return now - (schedulerTicks() - sample->ticks) / SCHEDULER_TICK_HZ;
+}
+
+/**
+ * NAME: displayTask()
+ * DESCRIPTION: Task to update the LED Display and Remote LED Display after a sample has been POSTed.
+ * PROCESS:   Poll the persistent connection to the Remote LED Display (every pass so acknowledgements and reconnects are handled promptly)
+ *            Select the REMOTE_DISPLAY_VIEW on every new connection (the Remote LED Display may have been reset)
+ *            Display POST Count on the LED's
+ *            Queue the Status command for the Remote LED Display (YELLOW on error else alternate PURPLE and WHITE)
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void displayTask()
+{
+  // Keep the connection to the Remote LED Display open and deliver its commands
+#if HAS_LCD == true
+  displayLinkPoll();
+  if(displayLinkConnected() != displayConnected)
+  {
+    displayConnected = displayLinkConnected();
+    if(displayConnected)
+    {
+      uint8_t view = REMOTE_DISPLAY_VIEW;
+      displayLinkSend(DISPLAY_OP_VIEW, &view, 1);
+    }
+  }
+#endif
+
+  if(!displayPending)
+    return;
+  displayPending = false;
 
   // Display POST Count on the LED's
   ++postCount;
@@ -164,32 +733,43 @@ void loop()
 
   // Display Status on Remot LED Display
 #if HAS_LCD == true
-  String color = "";
-  if(errorCount != 0)
+  uint8_t color;
+  if(postErrorCount != 0)
   {
-    color = "YELLOW";
+    color = DISPLAY_COLOR_YELLOW;
   }
   else
   {
     if((postCount & 0x01) == 1)
-      color = "PURPLE";
+      color = DISPLAY_COLOR_PURPLE;
     else
-      color = "WHITE";    
+      color = DISPLAY_COLOR_WHITE;    
   }
-  displayRemoteLED("LED", color);
+  displayLinkSend(DISPLAY_OP_LED, &color, 1);
 #endif
+}
 
-  // Disable the Watch Dog while we are sleeping in wait()
-  wdEnable = false;
-
-  // Sleep until we need to read the sensors again
-  wait(SAMPLE_TIME_SECS * 1000UL);
+/**
+ * NAME: inputTask()
+ * DESCRIPTION: Task to process the Lucky Shield input events and the Serial commands.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void inputTask()
+{
+  serviceInputs();
+  serviceSerial();
 }
 
 /**
  * NAME: readConfiguration()
  * DESCRIPTION: Read the Configuration Settings from the EEPROM.
  * PROCESS:   Read 4 null terminated strings: [0] = Configuration Status, [1] = SSID, [2] = SSID Password, [3] = Display IP Address
+ *            The strings must end within the EEPROM_CONFIG_SIZE bytes of the Configuration Settings
  * 
  * INPUTS:
  *    None
@@ -200,21 +780,25 @@ void loop()
 bool readConfiguration()
 {
   int tokens = 0;
-  int address = 0;
+  int address = EEPROM_CONFIG_ADDRESS;
   byte value;
   int index = 0;
-  char buffer[50];
+  char buffer[EEPROM_CONFIG_SIZE];
   String flag = "";
 
   // Read all 4 Configuration Tokens
-  Log.verbose(F("Reading Configuration Settings from EEPROM\n"));
+  LOG_VERBOSE(F("Reading Configuration Settings from EEPROM\n"));
   while(tokens < 4)
   {
+    // Treat Configuration Settings that run past their EEPROM block as not set
+    if(address >= EEPROM_CONFIG_ADDRESS + EEPROM_CONFIG_SIZE)
+      return false;
+
     // Get value from EEPROM
     value = EEPROM.read(address);
 
     // Check if the Configuration Flag is not set and if not set just return so we can display the Configuration Page
-    if(tokens == 0 && address == 0 && value != 1)
+    if(tokens == 0 && address == EEPROM_CONFIG_ADDRESS && value != 1)
       return false;
 
     // If at end of a Token then end buffer and save value in String
@@ -231,21 +815,21 @@ bool readConfiguration()
       else if(tokens == 1)
       {
           String s1 = String(buffer);
-          s1.toCharArray(ssid, s1.length()+1);
+          s1.toCharArray(ssid, sizeof(ssid));
           ++tokens;
           index = 0;
       }
       else if(tokens == 2)
       {
           String s2 = String(buffer);
-          s2.toCharArray(pass, s2.length()+1);
+          s2.toCharArray(pass, sizeof(pass));
          ++tokens;
           index = 0;
       }
       else if(tokens == 3)
       {
           String s3 = String(buffer);
-          s3.toCharArray(ledDisplayAddress, s3.length()+1);
+          s3.toCharArray(ledDisplayAddress, sizeof(ledDisplayAddress));
           ++tokens;
           index = 0;
       }
@@ -258,31 +842,58 @@ bool readConfiguration()
   }
 
   // Print out results and return OK
-  Log.verbose(F("EEPROM Configuration Values are: \n"));
-  Log.verbose("%s\n", ssid);
-  Log.verbose("%s\n", pass);
-  Log.verbose("%s\n", ledDisplayAddress);
+  LOG_VERBOSE(F("EEPROM Configuration Values are: \n"));
+  LOG_VERBOSE("%s\n", ssid);
+  LOG_VERBOSE("%s\n", pass);
+  LOG_VERBOSE("%s\n", ledDisplayAddress);
   return true;
 }
 
+/**
+ * NAME: configurationFits()
+ * DESCRIPTION: Utility method to check that the Configuration Settings fit in their global variables and in their EEPROM block.
+ * 
+ * INPUTS:
+ *    SSID, SSID Password, and Display IP Address
+ * OUTPUTS:
+ *    True if the Configuration Settings fit
+ *    
+ */
+bool configurationFits(const String &ssid, const String &password, const String &displayIp)
+{
+  if(ssid.length() >= CONFIG_SSID_SIZE || password.length() >= CONFIG_PASS_SIZE || displayIp.length() >= sizeof(ledDisplayAddress))
+    return false;
+
+  // Configuration Set flag, then each string, all null terminated
+  return 2 + (ssid.length() + 1) + (password.length() + 1) + (displayIp.length() + 1) <= EEPROM_CONFIG_SIZE;
+}
+
 /**
  * NAME: writeConfiguration()
  * DESCRIPTION: Write the Configuration Settings from the EEPROM.
  * PROCESS:   Write 4 null terminated strings: [0] = Configuration Status, [1] = SSID, [2] = SSID Password, [3] = Display IP Address
+ *            Nothing is written if they do not fit in the EEPROM_CONFIG_SIZE bytes of the Configuration Settings
  * 
  * INPUTS:
  *    SSID, SSID Password, and Display IP Address
  * OUTPUTS:
- *    None
+ *    True if the Configuration Settings were written else return false
  *    
  */
-void writeConfiguration(String ssid, String password, String displayIp)
+bool writeConfiguration(String ssid, String password, String displayIp)
 {
-  int address = 0;
+  int address = EEPROM_CONFIG_ADDRESS;
+
+  // Keep the Configuration Settings within their EEPROM block (the rest of the EEPROM is owned by other modules)
+  if(!configurationFits(ssid, password, displayIp))
+  {
+    LOG_ERROR(F("Configuration Settings do not fit in EEPROM\n"));
+    return false;
+  }
 
-  // Clear out EEPROM
-  Log.verbose(F("Writing Configuration Settings to EEPROM\n"));
-  for (int i = 0;i < EEPROM.length();++i)
+  // Clear out the Configuration Settings in EEPROM (the rest of the EEPROM is owned by other modules)
+  LOG_VERBOSE(F("Writing Configuration Settings to EEPROM\n"));
+  for (int i = EEPROM_CONFIG_ADDRESS;i < EEPROM_CONFIG_ADDRESS + EEPROM_CONFIG_SIZE;++i)
     EEPROM.write(i, 0xFF);
   // Write Configuration Set flag
   EEPROM.write(address++, 1);
@@ -299,6 +910,7 @@ void writeConfiguration(String ssid, String password, String displayIp)
   for (int i = 0;i < displayIp.length();++i)
     EEPROM.write(address++, displayIp[i]);
   EEPROM.write(address++, 0);
+  return true;
 }
 
 /**
@@ -335,23 +947,27 @@ void configurationStartupCheck(bool ignoreButtonCheck)
       String s1 = getConfiguredSSID();
       String s2 = getConfiguredPW();
       String s3 = getConfiguredDisplayIP();   
-      if(s1.length() == 0 || s3.length() == 0)
+      if(s1.length() == 0 || s3.length() == 0 || !configurationFits(s1, s2, s3))
       {
+        LOG_ERROR(F("SSID, SSID Password, or Display IP Address is missing or too long\n"));
         // Error sound Buzzer three times
         tone(5, 0); tone(5, 500); delay(500); noTone(5); delay(500); tone(5, 500); delay(500); noTone(5); tone(5, 500); delay(500); noTone(5);
       }
       else
       {
         // Save the Configuration in the global variables
-        s1.toCharArray(ssid, s1.length()+1);        
-        Log.verbose(F("SSID Configured to %s\n"), s1.c_str());
-        s2.toCharArray(pass, s2.length()+1);
-        Log.verbose(F("SSID Password Configured to %s\n"), s2.c_str());
-        s3.toCharArray(ledDisplayAddress, s3.length()+1);
-        Log.verbose(F("Display IP Address Configured to %s\n"), s3.c_str());
+        s1.toCharArray(ssid, sizeof(ssid));        
+        LOG_VERBOSE(F("SSID Configured to %s\n"), s1.c_str());
+        s2.toCharArray(pass, sizeof(pass));
+        LOG_VERBOSE(F("SSID Password Configured to %s\n"), s2.c_str());
+        s3.toCharArray(ledDisplayAddress, sizeof(ledDisplayAddress));
+        LOG_VERBOSE(F("Display IP Address Configured to %s\n"), s3.c_str());
 
         // Save the Configuration in EEPROM
         writeConfiguration(ssid, pass, ledDisplayAddress);
+
+        // Save the REST Endpoints in EEPROM
+        configureEndpoints();
       }
     }
     else
@@ -362,6 +978,45 @@ void configurationStartupCheck(bool ignoreButtonCheck)
   }
 }
 
+/**
+ * NAME: configureEndpoints()
+ * DESCRIPTION: Utility method to save the REST Endpoints set on the Configuration Page.
+ * PROCESS:   Enable the REST Endpoints that were checked
+ *            Replace the selected REST Endpoint with the host, port, path, and format that were entered
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void configureEndpoints()
+{
+  uint8_t enabled = 0;
+  char name[3] = "e0";
+  for(int i = 0;i < ENDPOINT_SLOTS;++i)
+  {
+    name[1] = '0' + i;
+    if(getConfiguredValue(name).length() != 0)
+      enabled |= 1 << i;
+  }
+  String slot = getConfiguredValue("slot");
+  String host = getConfiguredValue("host");
+  String path = getConfiguredValue("path");
+  host.trim();
+  path.trim();
+  int replace = (slot.length() == 0 || host.length() == 0) ? -1 : slot.toInt();
+  if(replace >= 0)
+    enabled |= 1 << replace;
+  if(!endpointsConfigure(enabled, replace, host.c_str(), getConfiguredValue("port").toInt(), path.c_str(), getConfiguredValue("format").toInt()))
+    LOG_VERBOSE(F("REST Endpoint override rejected, the port is invalid or the host and path are too long\n"));
+  for(int i = 0;i < ENDPOINT_SLOTS;++i)
+  {
+    if(endpointsEnabled() & (1 << i))
+      LOG_VERBOSE(F("REST Endpoint %d Configured to %s:%d\n"), i + 1, endpointGet(i)->host, endpointGet(i)->port);
+  }
+}
+
 /**
  * NAME: freeRam()
  * DESCRIPTION: Utility method to get Free RAM
@@ -379,6 +1034,40 @@ int freeRam()
   return (int)&v - (__brkval == 0 ? (int)&__heap_start : (int)__brkval);
 }
 
+/**
+ * NAME: logSampleStats()
+ * DESCRIPTION: Utility method to log the statistics of the reads of a metric in the sample window (values in hundredths).
+ * 
+ * INPUTS:
+ *    name    Name of the metric
+ *    stats   The metric statistics
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void logSampleStats(const __FlashStringHelper *name, const sample_stats *stats)
+{
+  LOG_VERBOSE(F("%S: %d reads, min %d, max %d, mean %d, std dev %d, last %d\n"), name, stats->count, stats->min, stats->max, statsMean(stats), statsStdDev(stats), stats->last);
+}
+
+/**
+ * NAME: logI2CStats()
+ * DESCRIPTION: Utility method to log the I2C bus budget used since the last reset and reset the counters (only when I2C_STATS is enabled).
+ * 
+ * INPUTS:
+ *    label   Name of the driver call that was measured
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void logI2CStats(const __FlashStringHelper *label)
+{
+#if I2C_STATS
+  LOG_VERBOSE(F("I2C budget of %S: %d transactions, %d bytes, %l us\n"), label, i2cStats.transactions, i2cStats.bytes, i2cStats.busTimeUs);
+  i2cStatsReset();
+#endif
+}
+
 /**
  * NAME: connectToWifi()
  * DESCRIPTION: Connect to the Wifi Network using global SSID, Username, and Password.
@@ -394,204 +1083,262 @@ void connectToWifi()
   int status = WL_IDLE_STATUS;
   while (status != WL_CONNECTED) 
   {
-    Log.verbose(F("Attempting to connect to Network named: %s\n"), ssid);
+    LOG_VERBOSE(F("Attempting to connect to Network named: %s\n"), ssid);
     status = WiFi.begin(ssid, pass);
-    Log.verbose(F("You're connected to the network\n"));
-    Log.verbose(F("SSID: %s\n"), WiFi.SSID());
-    Log.verbose(F("IP Address: %d.%d.%d.%d\n"), WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
+    LOG_VERBOSE(F("You're connected to the network\n"));
+    LOG_VERBOSE(F("SSID: %s\n"), WiFi.SSID());
+    LOG_VERBOSE(F("IP Address: %d.%d.%d.%d\n"), WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
   }  
 }
 
 /**
- * NAME: wait()
- * DESCRIPTION: Utility method to accurately wait the Sample Time.
+ * NAME: serviceInputs()
+ * DESCRIPTION: Utility method to process the Joy Stick, Push Button, and PIR events from the Lucky Shield.
+ * PROCESS:   Read the Lucky Shield inputs if they signalled a change
+ *            Log every debounced input event
  * 
  * INPUTS:
- *    waitTime  Time to wait in milliseconds
+ *    None
  * OUTPUTS:
  *    None
  *    
  */
-void wait(unsigned long waitTime)
+void serviceInputs()
 {
-  // Hang until the Sample Time has expired
-  unsigned long currentMillis = millis();
-  unsigned long previousMillis = currentMillis;
-  do
+  cat9555_event event;
+  lucky.gpio().update();
+  while(lucky.gpio().readEvent(event))
   {
-    currentMillis = millis();
-  }while (currentMillis - previousMillis < waitTime);
+    LOG_VERBOSE(F("Input 0x%x changed to %d at %l ms\n"), event.pin, event.level, event.time);
+  }
 }
  
 /**
- * NAME: createJSON()
- * DESCRIPTION: Utility method to convert sensor data to JSON.
+ * NAME: serviceSerial()
+ * DESCRIPTION: Utility method to process the single character commands received on Serial.
+ * PROCESS:   SERIAL_COMMAND_METRICS logs the timing metrics (waiting for the log to drain, the dump is longer than the log buffer)
+ *            SERIAL_COMMAND_CLEAR clears the timing metrics
+ *            Any other character is ignored
  * 
  * INPUTS:
- *    float temperature   The temperature read from the sensor
- *    float pressure      The pressure read from the sensor
- *    float humidity      The humidity read from the sensor
+ *    None
  * OUTPUTS:
- *    JSON formatted sensor data per the REST API specification
+ *    None
  *    
  */
-String createJSON(float temperature, float pressure, float humidity)
+void serviceSerial()
 {
-  // Round everything to just 2 decimal places
-  temperature = roundf((temperature * 100 + .5))/100;
-  pressure = roundf((pressure * 100 + .5))/100;
-  humidity = roundf((humidity * 100 + .5))/100;
-
-  // Convert sensor values to JSON using the JSON Library
-  StaticJsonBuffer<200> jsonBuffer;
-  JsonObject& root = jsonBuffer.createObject();
-  root["deviceID"] = 1;
-  root["temperature"] = temperature;
-  root["pressure"] = pressure;
-  root["humidity"] = humidity;
-  
-  // Return JSON as a string
-  String json;
-  root.printTo(json);
-  return json;
+  while(Serial.available() > 0)
+  {
+    switch(Serial.read())
+    {
+#if METRICS
+      case SERIAL_COMMAND_METRICS:
+        logBuffer.setBlocking(true);
+#if LOW_POWER == true
+        LOG_NOTICE(F("CPU asleep %d permille of the time\n"), powerAsleepPermille());
+#endif
+        LOG_NOTICE(F("Log dropped %d bytes\n"), logBuffer.dropped());
+        metricsDump();
+        logBuffer.setBlocking(false);
+        break;
+      case SERIAL_COMMAND_CLEAR:
+        metricsReset();
+        LOG_NOTICE(F("Metrics cleared\n"));
+        break;
+#endif
+      default:
+        break;
+    }
+  }
 }
 
 /**
- * NAME: displayLED()
- * DESCRIPTION: Utility method to update the LED Display.
- * PROCESS:   Bit 0 of input value is displayed on LED1
- *            Bit 1 of input value is displayed on LED2
+ * NAME: writePostBody()
+ * DESCRIPTION: Utility method to stream the samples being POSTed in a payload format, used by the dispatcher for the Content-Length and the body.
  * 
  * INPUTS:
- *    int value   The count to take 2 bits from for the LED Display
+ *    Print &out        Where to write the payload
+ *    uint8_t format    PAYLOAD_JSON or PAYLOAD_CBOR
  * OUTPUTS:
  *    None
  *    
  */
-void displayLED(int value)
+void writePostBody(Print &out, uint8_t format)
 {
-  // Display values as a 2 bit binary value on LED1 and LED2
-  if(value & 0x01)
-    lucky.gpio().digitalWrite(LED1,HIGH);
+  if(format == PAYLOAD_CBOR)
+    writePostCBOR(out);
   else
-    lucky.gpio().digitalWrite(LED1,LOW);    
-  if(value & 0x02)
-    lucky.gpio().digitalWrite(LED2,HIGH);
-  else
-    lucky.gpio().digitalWrite(LED2,LOW);    
+    writePostJSON(out);
 }
 
 /**
- * NAME: displayRemoteLED()
- * DESCRIPTION: Utility method to send a Command and Data to a Remote LCD Display over a Wifi Connection.
- * PROCESS:   Connect to remote LED Display Arduino
- *            Send Command and Data
+ * NAME: writePostJSON()
+ * DESCRIPTION: Utility method to stream the samples being POSTed as JSON.
+ * PROCESS:   Write a single JSON object for a single sample or else a JSON array of samples
+ *            Sensor values are written straight from the fixed point hundredths without using the heap
+ *            The first sample carries the timing metrics snapshot as a "metrics" member when postMetrics is set
  * 
  * INPUTS:
- *    String cmd    The Command for the remote LCD Display (LED and MESSAGE)
- *    String data   The Command Data for the remote LED Display (LCD color and MESSAGE msg)
+ *    Print &out    Where to write the JSON
  * OUTPUTS:
  *    None
  *    
  */
-void displayRemoteLED(String cmd, String data)
+void writePostJSON(Print &out)
 {
-  Serial.print("Connecting to ");
- Log.verbose("%s\n", ledDisplayAddress);
-  
-  Log.verbose(F("Sending Message to Remote LED Display........"));
-  if (remoteLedClient.connect(ledDisplayAddress, ledDisplayPort)) 
+  JsonWriter json(out);
+  bool batch = postReplaySlot < 0 && BATCH_SIZE > 1;
+  if(batch)
+    json.beginArray();
+  for(uint8_t i = 0;i < postSampleCount;++i)
   {
-    Log.verbose(F("connected to Remote LED Display....."));
-    remoteLedClient.print(cmd + "=" + data + "\n");
-    Log.verbose(F("message sent\n\n"));
+    const queued_sample *sample = &postSamples[i];
+    json.beginObject();
+    json.field(F("deviceID"), 1);
+    if(postTimestamps && sample->timestamp != 0)
+      json.field(F("timestamp"), sample->timestamp);
+    json.fieldFixed(F("temperature"), sample->temperature, 2);
+    json.fieldFixed(F("pressure"), sample->pressure, 2);
+    json.fieldFixed(F("humidity"), sample->humidity, 2);
+#if METRICS
+    if(postMetrics && i == 0)
+      metricsWriteJSON(json);
+#endif
+    json.endObject();
   }
-  else
+  if(batch)
+    json.endArray();
+}
+
+/**
+ * NAME: writePostCBOR()
+ * DESCRIPTION: Utility method to stream the samples being POSTed as CBOR (app/lucky/tools/weather_server.py is a reference decoder).
+ * PROCESS:   Write the schema version, device ID, and an array of samples (even for a single sample):
+ *              [ CBOR_SCHEMA_VERSION, deviceID, [ [timestamp, temperature, pressure, humidity], ... ] ]
+ *            The timestamp is epoch seconds (0 if not known) and the sensor values are integers in hundredths
+ *            of a degree F, an inHg, and a % so no floating point is needed on either side
+ *            When postMetrics is set the schema is CBOR_METRICS_SCHEMA_VERSION and the timing metrics snapshot is appended:
+ *              [ CBOR_METRICS_SCHEMA_VERSION, deviceID, [ ... ], metrics ]
+ * 
+ * INPUTS:
+ *    Print &out    Where to write the CBOR
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void writePostCBOR(Print &out)
+{
+  CborWriter cbor(out);
+#if METRICS
+  cbor.array(postMetrics ? 4 : 3);
+  cbor.integer(postMetrics ? CBOR_METRICS_SCHEMA_VERSION : CBOR_SCHEMA_VERSION);
+#else
+  cbor.array(3);
+  cbor.integer(CBOR_SCHEMA_VERSION);
+#endif
+  cbor.integer(1);
+  cbor.array(postSampleCount);
+  for(uint8_t i = 0;i < postSampleCount;++i)
   {
-    Log.verbose(F("no Connection to Remote LED Display\n\n"));
+    const queued_sample *sample = &postSamples[i];
+    cbor.array(4);
+    cbor.integer(postTimestamps ? sample->timestamp : 0);
+    cbor.integer(sample->temperature);
+    cbor.integer(sample->pressure);
+    cbor.integer(sample->humidity);
   }
+#if METRICS
+  if(postMetrics)
+    metricsWriteCBOR(cbor);
+#endif
 }
 
 /**
- * NAME: testEndpoint()
- * DESCRIPTION: Utility method to access the Test API from the REST Endpoint (only used for basic testing during development).
- * PROCESS:   Log the GET Request parameters
- *            Create a HTTP Client Connection
- *            Make a HTTP GET Request with Basic HTTP Authentication Headers set
- *            Log the Status and Response back from the HTTP GET Request            
+ * NAME: sendDisplayHistory()
+ * DESCRIPTION: Utility method to send the samples being POSTed to the chart on the Remote LED Display.
+ * PROCESS:   Pack up to DISPLAY_MAX_POINTS samples into each HISTORY command (a batch is a single command unless BATCH_SIZE is larger)
+ *            Each point is the timestamp, temperature, pressure, and humidity (little endian, see DisplayProtocol.h)
  * 
  * INPUTS:
- *    String serverAddress    The REST API Endpoint server domain address
- *    String uri              The REST API Endpoint server URI
- *    int port                The REST API Endpoint server Port
+ *    None
  * OUTPUTS:
  *    None
  *    
  */
-void testEndpoint(String serverAddress, String uri, int port)
+void sendDisplayHistory()
 {
-  // Send HTTP GET Request to the Server for the Test REST API
-  Log.verbose(F("Making GET request with HTTP basic authentication to %s\n"), serverAddress.c_str());
-  HttpClient client = HttpClient(port == 443 ? wifiSecure : wifi, serverAddress, port);
-  client.beginRequest();
-  client.get(uri);
-  client.sendBasicAuth("CloudWorkshop", "dGVzdHRlc3Q=");
-  client.endRequest();
-
-  // Read the status code and body of the response
-  int statusCode = client.responseStatusCode();
-  String response = client.responseBody();
-
-  // Print status and response to the Verbose Logger
-  Log.verbose(F("Return Status code: %d\n"), statusCode);
-  Log.verbose(F("Return Response: %s\n"), response.c_str());
+  uint8_t args[DISPLAY_MAX_ARGS];
+  for(uint8_t i = 0;i < postSampleCount;i += DISPLAY_MAX_POINTS)
+  {
+    uint8_t count = min(postSampleCount - i, DISPLAY_MAX_POINTS);
+    uint8_t *point = args + 1;
+    args[0] = count;
+    for(uint8_t j = 0;j < count;++j)
+    {
+      const queued_sample *sample = &postSamples[i + j];
+      uint32_t timestamp = sample->timestamp;
+      point[0] = timestamp;
+      point[1] = timestamp >> 8;
+      point[2] = timestamp >> 16;
+      point[3] = timestamp >> 24;
+      point[4] = sample->temperature;
+      point[5] = sample->temperature >> 8;
+      point[6] = sample->pressure;
+      point[7] = sample->pressure >> 8;
+      point[8] = sample->humidity;
+      point[9] = sample->humidity >> 8;
+      point += DISPLAY_POINT_SIZE;
+    }
+    displayLinkSend(DISPLAY_OP_HISTORY, args, 1 + count * DISPLAY_POINT_SIZE);
+  }
 }
 
 /**
- * NAME: postToEndpoint()
- * DESCRIPTION: Utility method to access the Save API from the REST Endpoint.
- * PROCESS:   Log the POST Request parameters
+ * NAME: testEndpoint()
+ * DESCRIPTION: Utility method to access the Test API from the REST Endpoint (only used for basic testing during development).
+ * PROCESS:   Log the GET Request parameters
  *            Create a HTTP Client Connection
- *            Make a HTTP POST Request with Basic HTTP Authentication Headers set and JSON payload
- *            Log the Status and Response back from the HTTP GET Request            
+ *            Make a HTTP GET Request with Basic HTTP Authentication Headers set
+ *            Log the Status and the start of the Response back from the HTTP GET Request (the rest is not read)
  * 
  * INPUTS:
  *    String serverAddress    The REST API Endpoint server domain address
  *    String uri              The REST API Endpoint server URI
  *    int port                The REST API Endpoint server Port
- *    int json                The JSON to send to the Endpoint server
  * OUTPUTS:
- *    HTTP Status Code
+ *    None
  *    
  */
-int postToEndpoint(String serverAddress, String uri, int port, String json)
+void testEndpoint(String serverAddress, String uri, int port)
 {
-  // Send HTTP POST Request to the Server for the Save REST API
-  Log.verbose(F("Making POST request with HTTP basic authentication to %s\n"), serverAddress.c_str());
-  HttpClient client = HttpClient(wifi, serverAddress, port);
-  client.setHttpResponseTimeout(60 * 1000);
+  // Send HTTP GET Request to the Server for the Test REST API
+  LOG_VERBOSE(F("Making GET request with HTTP basic authentication to %s\n"), serverAddress.c_str());
+  HttpClient client = HttpClient(port == 443 ? wifiSecure : wifi, serverAddress, port);
   client.beginRequest();
-  client.post(uri);
+  client.get(uri);
   client.sendBasicAuth("CloudWorkshop", "dGVzdHRlc3Q=");
-  client.sendHeader("Content-Type", "application/json");
-  client.sendHeader("Content-Length", json.length());
-  client.beginBody();
-  client.print(json);
   client.endRequest();
 
-  // Read the status code and body of the response
+  // Read the status code and only the start of the body of the response
   int statusCode = client.responseStatusCode();
-  String response = client.responseBody();
+  client.skipResponseHeaders();
+  char response[TEST_RESPONSE_SIZE];
+  int length = 0;
+  unsigned long start = millis();
+  while(length < TEST_RESPONSE_SIZE - 1 && !client.endOfBodyReached() && client.connected() && millis() - start < DISPATCH_TIMEOUT_MS)
+  {
+    if(client.available())
+      response[length++] = client.read();
+  }
+  response[length] = '\0';
+  client.stop();
 
   // Print status and response to the Verbose Logger
-  Log.verbose(F("Return Status code: %d\n"), statusCode);
-  Log.verbose(F("Return Response: %s\n"), response.c_str());
-
-  // Return HTTP Status Code
-  return statusCode;
+  LOG_VERBOSE(F("Return Status code: %d\n"), statusCode);
+  LOG_VERBOSE(F("Return Response: %s\n"), response);
 }
 
-
 /**
  * NAME: initRTC()
  * DESCRIPTION: Utility method to initialize the Real Time Clock.
@@ -605,7 +1352,7 @@ int postToEndpoint(String serverAddress, String uri, int port, String json)
 void initRTC()
 {
    // Disable RTC interrupts
-  Log.verbose(F("Initializing the RTC and internal Watch Dog....."));   
+  LOG_VERBOSE(F("Initializing the RTC and internal Watch Dog....."));   
   cli();
    
   // Initialize 32.768kHz Oscillator and disable the oscillator
@@ -632,22 +1379,24 @@ void initRTC()
   //Initialize RTC and wait for all register to be synchronized
   while (RTC.STATUS > 0);
 
-  // Set 32.768kHz External Crystal Oscillator (XOSC32K), enable Periodic Interrupts, at RTC Clock Cycles 32768 (1 second)
+  // Set 32.768kHz External Crystal Oscillator (XOSC32K), enable Periodic Interrupts, at RTC Clock Cycles 4096 (1/8 second scheduler tick)
   RTC.CLKSEL = RTC_CLKSEL_TOSC32K_gc;
   RTC.DBGCTRL = RTC_DBGRUN_bm;
   RTC.PITINTCTRL = RTC_PI_bm; 
-  RTC.PITCTRLA = RTC_PERIOD_CYC32768_gc | RTC_PITEN_bm;
+  RTC.PITCTRLA = RTC_PERIOD_CYC4096_gc | RTC_PITEN_bm;
 
   // Enable RTC interrupts
   sei();
-  Log.verbose(F("complete\n"));   
+  LOG_VERBOSE(F("complete\n"));   
 }
 
 /**
  * NAME: ISR()
  * DESCRIPTION: Interrupt Service Routine for RTC.
- * PROCESS:   Decrement applications Watch Dog counter.
- *            If applications Watch Dog counter hits 0 then use real Watch Dog Timer to reset the Arduino (the Application will reset the applications Watch Dog counter in loop()). 
+ * PROCESS:   Advance the Task Scheduler tick.
+ *            Once a second decrement applications Watch Dog counter.
+ *            If applications Watch Dog counter hits 0 then use real Watch Dog Timer to reset the Arduino (the Application will reset the applications Watch Dog counter in watchdogTask()). 
+ *            Once the Watch Dog expired drain the log from here (loop() is assumed hung) so the log gets out before the reset.
  * 
  * INPUTS:
  *    None
@@ -657,17 +1406,28 @@ void initRTC()
  */
 ISR(RTC_PIT_vect)
 {
+  static uint8_t wdTicks = 0;
+
   // Clear interrupt flag by writing '1'
   RTC.PITINTFLAGS = RTC_PI_bm;
 
+  // Advance the Task Scheduler and only run the Watch Dog once a second
+  schedulerTick();
+  if(wdExpired)
+    logBuffer.drain();
+  if(++wdTicks < SCHEDULER_TICK_HZ)
+    return;
+  wdTicks = 0;
+
   // If Watch Dog enabled then decrement Watch Dog count and if we hit 0 then assume Arduino hung so use the actual Watch Dog Timer to reset the Arduino
   if(wdEnable)
   {
     --wdSecCount;
     if(wdSecCount == 0)
     {
-      Serial.println("Watch Dog expired and going to reset the Arduino in 2 seconds");
+      logBuffer.message(F("Watch Dog expired and going to reset the Arduino in 2 seconds\n"));
       wdEnable = false;
+      wdExpired = true;
       wdt_enable(WDTO_2S);
     }
   }
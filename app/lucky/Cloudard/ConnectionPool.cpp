@@ -0,0 +1,350 @@
+#include "ConnectionPool.h"
+#include <utility/server_drv.h>
+#include "LogBuffer.h"
+#include "Scheduler.h"
+
+typedef struct
+{
+  const char *host;
+  uint16_t port;
+  IPAddress address;
+  uint32_t resolved;        // Scheduler tick of the last lookup of the address (millis() stops in standby)
+  uint8_t sock;
+  bool busy;
+  bool resolving;           // Acquired but waiting for poolResolve() because the address is not known
+  uint32_t lastUsed;        // Scheduler tick the connection was last released
+} pooled_connection;
+
+static pooled_connection pool[POOL_SIZE];
+static bool poolInitialized = false;
+
+/**
+ * NAME: closeConnection()
+ * DESCRIPTION: Close the socket of a pooled connection (the host and resolved address are kept, see poolFail()).
+ * 
+ * INPUTS:
+ *    conn  The pooled connection
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void closeConnection(pooled_connection *conn)
+{
+  if(conn->sock != NO_SOCKET_AVAIL)
+  {
+    WiFiClient(conn->sock).stop();
+    conn->sock = NO_SOCKET_AVAIL;
+  }
+}
+
+/**
+ * NAME: isAlive()
+ * DESCRIPTION: Check if an idle pooled connection can be reused.
+ * PROCESS:   The socket must still be established (the server may have closed it while it was idle)
+ *            There must not be any unread data (anything the server sent while idle means the connection is out of step)
+ *            The connection must not have been idle longer than POOL_MAX_IDLE_SECS
+ * 
+ * INPUTS:
+ *    conn  The pooled connection
+ * OUTPUTS:
+ *    True if the connection can be reused
+ *    
+ */
+static bool isAlive(pooled_connection *conn)
+{
+  return conn->sock != NO_SOCKET_AVAIL &&
+         ServerDrv::getClientState(conn->sock) == ESTABLISHED &&
+         WiFiClient(conn->sock).available() == 0 &&
+         schedulerTicks() - conn->lastUsed < SECONDS_TO_TICKS(POOL_MAX_IDLE_SECS);
+}
+
+/**
+ * NAME: findSlot()
+ * DESCRIPTION: Find the idle slot for host:port or else the idle slot to replace.
+ * PROCESS:   Prefer the slot already holding host:port, then an unused slot, then a slot without an open socket, then the least recently used slot
+ * 
+ * INPUTS:
+ *    host    The REST API Endpoint server domain address
+ *    port    The REST API Endpoint server Port
+ * OUTPUTS:
+ *    Index of the slot or -1 if all slots are busy
+ *    
+ */
+static int findSlot(const char *host, uint16_t port)
+{
+  int index = -1;
+  for(int i = 0;i < POOL_SIZE;++i)
+  {
+    pooled_connection *conn = &pool[i];
+    if(conn->busy)
+      continue;
+    if(conn->host != NULL && conn->port == port && strcmp(conn->host, host) == 0)
+      return i;
+    if(index < 0)
+    {
+      index = i;
+      continue;
+    }
+    pooled_connection *best = &pool[index];
+    if(best->host == NULL)
+      continue;
+    if(conn->host == NULL || (conn->sock == NO_SOCKET_AVAIL) > (best->sock == NO_SOCKET_AVAIL))
+      index = i;
+    else if((conn->sock == NO_SOCKET_AVAIL) == (best->sock == NO_SOCKET_AVAIL) && (long)(conn->lastUsed - best->lastUsed) < 0)
+      index = i;
+  }
+  return index;
+}
+
+/**
+ * NAME: startClient()
+ * DESCRIPTION: Allocate a NINA socket and start the connection to the resolved address without waiting for it to be established.
+ * 
+ * INPUTS:
+ *    conn  The pooled connection
+ * OUTPUTS:
+ *    0 or a negative Pool error code
+ *    
+ */
+static int startClient(pooled_connection *conn)
+{
+  conn->sock = ServerDrv::getSocket();
+  if(conn->sock == NO_SOCKET_AVAIL)
+    return POOL_ERROR_SOCKET;
+  ServerDrv::startClient(uint32_t(conn->address), conn->port, conn->sock, TCP_MODE);
+  return 0;
+}
+
+/**
+ * NAME: poolAcquire()
+ * DESCRIPTION: Get a connection to a host and port, reusing an open keep-alive connection when possible (never blocks).
+ * PROCESS:   Reuse the idle connection for host:port if it is still alive else close it
+ *            Otherwise take a free slot or the least recently used idle slot
+ *            Start the connection to the cached address without waiting for it to be established
+ *            If the address is not known leave the connection resolving (see poolResolve())
+ * 
+ * INPUTS:
+ *    host    The REST API Endpoint server domain address
+ *    port    The REST API Endpoint server Port
+ *    reused  Set to true if an already open connection was returned
+ * OUTPUTS:
+ *    Index of the pooled connection or a negative Pool error code
+ *    
+ */
+int poolAcquire(const char *host, uint16_t port, bool *reused)
+{
+  if(!poolInitialized)
+  {
+    for(int i = 0;i < POOL_SIZE;++i)
+    {
+      pool[i].host = NULL;
+      pool[i].sock = NO_SOCKET_AVAIL;
+      pool[i].busy = false;
+      pool[i].resolving = false;
+    }
+    poolInitialized = true;
+  }
+
+  // Find the connection for host:port or else the best slot to replace
+  int index = findSlot(host, port);
+  if(index < 0)
+    return POOL_ERROR_SOCKET;
+
+  pooled_connection *conn = &pool[index];
+  *reused = false;
+  if(conn->host != NULL && conn->port == port && strcmp(conn->host, host) == 0)
+  {
+    if(isAlive(conn))
+    {
+      conn->busy = true;
+      *reused = true;
+      return index;
+    }
+  }
+  else
+  {
+    conn->host = host;
+    conn->port = port;
+    conn->address = IPAddress((uint32_t)0);
+  }
+  closeConnection(conn);
+
+  // Open a new connection (the DNS lookup blocks so it is left to the caller)
+  conn->busy = true;
+  conn->resolving = uint32_t(conn->address) == 0;
+  if(conn->resolving)
+    return index;
+  int error = startClient(conn);
+  if(error < 0)
+  {
+    conn->busy = false;
+    return error;
+  }
+  return index;
+}
+
+/**
+ * NAME: poolResolving()
+ * DESCRIPTION: Check if an acquired connection is waiting for its host to be resolved.
+ * 
+ * INPUTS:
+ *    index   Index of the pooled connection
+ * OUTPUTS:
+ *    True if poolResolve() has to be called before the connection is started
+ *    
+ */
+bool poolResolving(int index)
+{
+  return pool[index].resolving;
+}
+
+/**
+ * NAME: poolResolve()
+ * DESCRIPTION: Resolve the host of an acquired connection and start the connection.
+ * PROCESS:   The NINA module only answers once the lookup is done so this blocks for up to its DNS timeout,
+ *            callers resolve one connection per pass of the scheduler so the other connections keep moving
+ * 
+ * INPUTS:
+ *    index   Index of the pooled connection
+ * OUTPUTS:
+ *    0 or a negative Pool error code (return the connection with poolFail())
+ *    
+ */
+int poolResolve(int index)
+{
+  pooled_connection *conn = &pool[index];
+  conn->resolving = false;
+  conn->resolved = schedulerTicks();
+  if(!WiFi.hostByName(conn->host, conn->address))
+  {
+    conn->address = IPAddress((uint32_t)0);
+    return POOL_ERROR_DNS;
+  }
+  return startClient(conn);
+}
+
+/**
+ * NAME: poolConnected()
+ * DESCRIPTION: Check if a pooled connection is established.
+ * 
+ * INPUTS:
+ *    index   Index of the pooled connection
+ * OUTPUTS:
+ *    True once the connection is established
+ *    
+ */
+bool poolConnected(int index)
+{
+  return ServerDrv::getClientState(pool[index].sock) == ESTABLISHED;
+}
+
+/**
+ * NAME: poolClient()
+ * DESCRIPTION: Get a client to read and write a pooled connection.
+ * 
+ * INPUTS:
+ *    index   Index of the pooled connection
+ * OUTPUTS:
+ *    Client for the connection socket
+ *    
+ */
+WiFiClient poolClient(int index)
+{
+  return WiFiClient(pool[index].sock);
+}
+
+/**
+ * NAME: poolRelease()
+ * DESCRIPTION: Return a connection to the pool.
+ * 
+ * INPUTS:
+ *    index       Index of the pooled connection
+ *    keepAlive   True to keep the connection open for the next request (the complete response must have been read) else it is closed
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void poolRelease(int index, bool keepAlive)
+{
+  pooled_connection *conn = &pool[index];
+  if(!keepAlive)
+    closeConnection(conn);
+  conn->busy = false;
+  conn->lastUsed = schedulerTicks();
+}
+
+/**
+ * NAME: poolFail()
+ * DESCRIPTION: Return a connection that failed (did not connect, timed out, or broke off) to the pool.
+ * PROCESS:   Close the connection and forget the resolved address so the next connection resolves the host again
+ *            (the cloud hosts rotate their addresses and a stale one would fail until the next reset)
+ * 
+ * INPUTS:
+ *    index   Index of the pooled connection
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void poolFail(int index)
+{
+  pooled_connection *conn = &pool[index];
+  poolRelease(index, false);
+  conn->resolving = false;
+  conn->address = IPAddress((uint32_t)0);
+}
+
+/**
+ * NAME: poolExpire()
+ * DESCRIPTION: Close idle connections that have been open longer than POOL_MAX_IDLE_SECS or were closed by the server.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void poolExpire()
+{
+  for(int i = 0;i < POOL_SIZE && poolInitialized;++i)
+  {
+    pooled_connection *conn = &pool[i];
+    if(!conn->busy && conn->sock != NO_SOCKET_AVAIL && !isAlive(conn))
+    {
+      LOG_VERBOSE(F("Closing idle connection to %s\n"), conn->host);
+      closeConnection(conn);
+    }
+  }
+}
+
+/**
+ * NAME: poolRefresh()
+ * DESCRIPTION: Refresh the cached address of one idle connection, call between requests so requests rarely wait for DNS.
+ * PROCESS:   An address older than POOL_DNS_TTL_SECS, or one forgotten by poolFail() (retried every POOL_DNS_RETRY_SECS), is looked up again
+ *            An open keep-alive connection keeps using its socket, a failed lookup keeps the old address
+ *            At most one lookup is done per call (it blocks for up to the NINA DNS timeout)
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void poolRefresh()
+{
+  for(int i = 0;i < POOL_SIZE && poolInitialized;++i)
+  {
+    pooled_connection *conn = &pool[i];
+    if(conn->host == NULL || conn->busy)
+      continue;
+    uint32_t age = schedulerTicks() - conn->resolved;
+    if(age < SECONDS_TO_TICKS(uint32_t(conn->address) == 0 ? POOL_DNS_RETRY_SECS : POOL_DNS_TTL_SECS) || WiFi.status() != WL_CONNECTED)
+      continue;
+    IPAddress address;
+    if(WiFi.hostByName(conn->host, address))
+      conn->address = address;
+    else
+      LOG_VERBOSE(F("Could not refresh the address of %s\n"), conn->host);
+    conn->resolved = schedulerTicks();
+    return;
+  }
+}
@@ -0,0 +1,41 @@
+/**
+ * NAME: ConnectionPool.h
+ * DESCRIPTION: Header file for the pool of persistent (keep-alive) TCP connections to the REST endpoints.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef ConnectionPool_h
+#define ConnectionPool_h
+
+#include <Arduino.h>
+#include <WiFiNINA.h>
+
+// Number of pooled connections (one per REST endpoint and one held open by the Remote LED Display link)
+#define POOL_SIZE 5
+
+// Idle connections older than this (in seconds) are closed
+#define POOL_MAX_IDLE_SECS 120
+
+// Resolved addresses older than this (in seconds) are refreshed between requests (a failed lookup is retried after POOL_DNS_RETRY_SECS)
+#define POOL_DNS_TTL_SECS 600
+#define POOL_DNS_RETRY_SECS 60
+
+// Pool error codes
+#define POOL_ERROR_DNS      -1
+#define POOL_ERROR_SOCKET   -2
+
+extern int poolAcquire(const char *host, uint16_t port, bool *reused);
+extern bool poolResolving(int index);
+extern int poolResolve(int index);
+extern bool poolConnected(int index);
+extern WiFiClient poolClient(int index);
+extern void poolRelease(int index, bool keepAlive);
+extern void poolFail(int index);
+extern void poolExpire();
+extern void poolRefresh();
+
+#endif
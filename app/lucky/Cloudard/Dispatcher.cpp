@@ -0,0 +1,595 @@
+#include "Dispatcher.h"
+#include "ConnectionPool.h"
+#include "JsonWriter.h"
+#include "Metrics.h"
+#include <WiFiNINA.h>
+#include "LogBuffer.h"
+#include <ctype.h>
+
+// Longest header line prefix that is kept for matching header names
+#define DISPATCH_LINE_SIZE 32
+
+// Body bytes kept from each response for the log (only logged for responses that are not 2xx)
+#define DISPATCH_PREFIX_SIZE 32
+
+// Longest body (or chunk) that is read and thrown away to keep the connection open, a longer one closes the connection
+#define DISPATCH_MAX_DRAIN 1024L
+
+enum dispatch_state
+{
+  STATE_RESOLVING,
+  STATE_CONNECTING,
+  STATE_SENDING,
+  STATE_STATUS,
+  STATE_HEADERS,
+  STATE_BODY,
+  STATE_CHUNK_SIZE,
+  STATE_CHUNK_END,
+  STATE_TRAILERS,
+  STATE_DONE
+};
+
+typedef struct
+{
+  const endpoint *ep;
+  uint8_t slot;
+  uint8_t state;
+  int conn;               // Pooled connection index
+  bool reused;            // The connection was kept open from a previous request
+  bool retried;           // A failed reused connection has already been replaced
+  bool keepAlive;         // The server will keep the connection open after this response
+  bool chunked;           // The body uses chunked Transfer-Encoding
+  uint8_t digits;         // Status code digits parsed so far (chunk extension flag while parsing a chunk size)
+  uint8_t lineLength;
+  char line[DISPATCH_LINE_SIZE];
+  long remaining;         // Body (or chunk) bytes left to read (-1 = unknown)
+  uint8_t prefixLength;
+  char prefix[DISPATCH_PREFIX_SIZE];
+  int status;
+  unsigned long start;
+  uint32_t probe;         // Probe timer when the request started and when its connection was started
+  uint32_t connectProbe;
+} dispatch_request;
+
+static dispatch_request requests[DISPATCH_MAX_REQUESTS];
+static uint8_t requestCount = 0;
+static bool requestBatch = false;
+static dispatch_body requestBody = NULL;
+static uint16_t requestLength[PAYLOAD_FORMATS];
+
+// Print that collects the body into packets for the NINA module instead of sending a packet per byte
+class ClientWriter : public Print
+{
+  public:
+    ClientWriter(WiFiClient &client) : failed(false), client(client), length(0) {}
+    size_t write(uint8_t c)
+    {
+      if(length == sizeof(buffer))
+        flush();
+      buffer[length++] = c;
+      return 1;
+    }
+    void flush()
+    {
+      if(length != 0 && client.write(buffer, length) != length)
+        failed = true;
+      length = 0;
+    }
+    bool failed;
+
+  private:
+    WiFiClient &client;
+    uint8_t buffer[DISPATCH_WRITE_BUFFER_SIZE];
+    uint8_t length;
+};
+
+/**
+ * NAME: finishRequest()
+ * DESCRIPTION: Complete a request with a status and return its connection to the pool.
+ * 
+ * INPUTS:
+ *    request   The request
+ *    status    HTTP Status Code or Dispatch error code
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void finishRequest(dispatch_request *request, int status)
+{
+  request->status = status;
+  request->state = STATE_DONE;
+  METRICS_RECORD(METRIC_REQUEST(request->slot), request->probe);
+  METRICS_STATUS(request->slot, status);
+  if(request->conn >= 0)
+  {
+    // A connection that failed may have been to a stale address so the host is resolved again next time
+    if(status > 0)
+      poolRelease(request->conn, request->keepAlive && request->remaining == 0);
+    else
+      poolFail(request->conn);
+    request->conn = -1;
+  }
+  LOG_VERBOSE(F("POST to %s returned %d in %l ms%s\n"), request->ep->host, status, millis() - request->start, request->reused ? " (kept alive)" : "");
+  if((status < 200 || status > 299) && request->prefixLength != 0)
+  {
+    request->prefix[request->prefixLength] = '\0';
+    LOG_VERBOSE(F("Response from %s started with: %s\n"), request->ep->host, request->prefix);
+  }
+}
+
+/**
+ * NAME: keepPrefix()
+ * DESCRIPTION: Keep the start of the response body for the log (control characters are replaced with spaces).
+ * 
+ * INPUTS:
+ *    request   The request
+ *    data      Body bytes
+ *    length    Number of body bytes
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void keepPrefix(dispatch_request *request, const uint8_t *data, int length)
+{
+  while(length-- > 0 && request->prefixLength < DISPATCH_PREFIX_SIZE - 1)
+  {
+    char c = *data++;
+    request->prefix[request->prefixLength++] = (c < ' ' || c > '~') ? ' ' : c;
+  }
+}
+
+/**
+ * NAME: startBody()
+ * DESCRIPTION: Start reading the body (or a chunk of it) once its length is known.
+ * PROCESS:   A body too long to drain is only read until the log prefix is full and then the connection is closed
+ * 
+ * INPUTS:
+ *    request   The request
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void startBody(dispatch_request *request)
+{
+  if(request->remaining > DISPATCH_MAX_DRAIN)
+    request->keepAlive = false;
+  request->state = STATE_BODY;
+}
+
+/**
+ * NAME: startConnection()
+ * DESCRIPTION: Get a pooled connection for a request, an open keep-alive connection is used as is and a new one is started without blocking
+ *              (or left for dispatchPoll() to resolve if the address of the host is not known).
+ * 
+ * INPUTS:
+ *    request   The request
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void startConnection(dispatch_request *request)
+{
+  request->connectProbe = METRICS_START();
+  request->conn = poolAcquire(request->ep->host, request->ep->port, &request->reused);
+  if(request->conn < 0)
+  {
+    int error = request->conn == POOL_ERROR_DNS ? DISPATCH_ERROR_DNS : DISPATCH_ERROR_SOCKET;
+    request->conn = -1;
+    finishRequest(request, error);
+    return;
+  }
+  if(request->reused)
+    request->state = STATE_SENDING;
+  else
+    request->state = poolResolving(request->conn) ? STATE_RESOLVING : STATE_CONNECTING;
+}
+
+/**
+ * NAME: failRequest()
+ * DESCRIPTION: Handle a connection failure, a reused connection that the server had already closed is transparently replaced once.
+ * 
+ * INPUTS:
+ *    request   The request
+ *    error     The Dispatch error code if the request cannot be retried
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void failRequest(dispatch_request *request, int error)
+{
+  if(request->reused && !request->retried)
+  {
+    LOG_VERBOSE(F("Kept alive connection to %s was closed, reconnecting\n"), request->ep->host);
+    poolRelease(request->conn, false);
+    request->retried = true;
+    startConnection(request);
+    return;
+  }
+  request->keepAlive = false;
+  finishRequest(request, error);
+}
+
+/**
+ * NAME: sendRequest()
+ * DESCRIPTION: Send the HTTP POST Request with Basic HTTP Authentication Headers (if the REST Endpoint has credentials) and the payload
+ *              in the format of the REST Endpoint.
+ * 
+ * INPUTS:
+ *    request   The request
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void sendRequest(dispatch_request *request)
+{
+  char header[256];
+  char path[ENDPOINT_PATH_SIZE];
+  WiFiClient client = poolClient(request->conn);
+  endpointPath(request->slot, path, sizeof(path));
+  PGM_P auth = endpointAuth(request->slot);
+  int length = snprintf_P(header, sizeof(header),
+    PSTR("POST %s%S HTTP/1.1\r\nHost: %s\r\n%S%S%SContent-Type: %S\r\nContent-Length: %u\r\nConnection: keep-alive\r\n\r\n"),
+    path, requestBatch ? PSTR(ENDPOINT_BATCH_SUFFIX) : PSTR(""), request->ep->host,
+    auth != NULL ? PSTR("Authorization: Basic ") : PSTR(""), auth != NULL ? auth : PSTR(""), auth != NULL ? PSTR("\r\n") : PSTR(""),
+    request->ep->format == PAYLOAD_CBOR ? PSTR("application/cbor") : PSTR("application/json"), requestLength[request->ep->format]);
+  if(length >= (int)sizeof(header) || client.write((const uint8_t *)header, length) != (size_t)length)
+  {
+    failRequest(request, DISPATCH_ERROR_SEND);
+    return;
+  }
+
+  // Stream the body straight from the sample data
+  ClientWriter writer(client);
+  requestBody(writer, request->ep->format);
+  writer.flush();
+  if(writer.failed)
+  {
+    failRequest(request, DISPATCH_ERROR_SEND);
+    return;
+  }
+  request->status = 0;
+  request->digits = 0;
+  request->lineLength = 0;
+  request->keepAlive = true;
+  request->chunked = false;
+  request->remaining = -1;
+  request->prefixLength = 0;
+  request->state = STATE_STATUS;
+}
+
+/**
+ * NAME: endHeaderLine()
+ * DESCRIPTION: Process a complete header line, only the headers needed to find the end of the response are used.
+ * 
+ * INPUTS:
+ *    request   The request
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void endHeaderLine(dispatch_request *request)
+{
+  char *line = request->line;
+  line[request->lineLength] = '\0';
+  if(request->lineLength == 0)
+  {
+    // Blank line ends the headers, without a Content-Length or chunks the end of the body is unknown so the connection is closed
+    if(request->chunked)
+    {
+      request->remaining = 0;
+      request->digits = 0;
+      request->state = STATE_CHUNK_SIZE;
+    }
+    else if(request->remaining > 0)
+      startBody(request);
+    else
+    {
+      if(request->remaining < 0)
+        request->keepAlive = false;
+      finishRequest(request, request->status);
+    }
+  }
+  else if(strncasecmp_P(line, PSTR("content-length:"), 15) == 0)
+  {
+    request->remaining = atol(line + 15);
+  }
+  else if(strncasecmp_P(line, PSTR("connection:"), 11) == 0)
+  {
+    if(strstr_P(line, PSTR("close")) != NULL)
+      request->keepAlive = false;
+  }
+  else if(strncasecmp_P(line, PSTR("transfer-encoding:"), 18) == 0)
+  {
+    request->remaining = -1;
+    request->chunked = strstr_P(line, PSTR("chunked")) != NULL;
+  }
+  request->lineLength = 0;
+}
+
+/**
+ * NAME: receiveResponse()
+ * DESCRIPTION: Parse the response as it arrives.
+ * PROCESS:   Get the HTTP Status Code from the status line
+ *            Get Content-Length, Connection, and Transfer-Encoding from the headers
+ *            Skip the body (following the chunks of a chunked body) a packet at a time so the connection can be reused for 
+ *            the next request, keeping only a short prefix of it for the log
+ * 
+ * INPUTS:
+ *    request   The request
+ * OUTPUTS:
+ *    None
+ *    
+ */
+static void receiveResponse(dispatch_request *request)
+{
+  uint8_t buffer[32];
+  WiFiClient client = poolClient(request->conn);
+  int count = client.available();
+  if(count <= 0)
+  {
+    if(!client.connected())
+    {
+      // Closed before any response (a reused connection can be retried) or part way through the response
+      if(request->state == STATE_STATUS && request->digits == 0)
+        failRequest(request, DISPATCH_ERROR_CONNECT);
+      else
+      {
+        request->keepAlive = false;
+        finishRequest(request, request->status > 0 ? request->status : DISPATCH_ERROR_CONNECT);
+      }
+    }
+    return;
+  }
+  count = client.read(buffer, count < (int)sizeof(buffer) ? count : sizeof(buffer));
+  for(int i = 0;i < count && request->state != STATE_DONE;++i)
+  {
+    char c = buffer[i];
+    switch(request->state)
+    {
+      case STATE_STATUS:
+        if(c == '\n')
+        {
+          request->lineLength = 0;
+          request->state = STATE_HEADERS;
+        }
+        else if(request->lineLength == 0)
+          request->lineLength = (c == ' ');   // The status code follows the space after the HTTP version
+        else if(c >= '0' && c <= '9' && request->digits < 3)
+        {
+          request->status = request->status * 10 + (c - '0');
+          ++request->digits;
+        }
+        break;
+      case STATE_HEADERS:
+        if(c == '\n')
+          endHeaderLine(request);
+        else if(c != '\r' && request->lineLength < DISPATCH_LINE_SIZE - 1)
+          request->line[request->lineLength++] = c;
+        break;
+      case STATE_BODY:
+      {
+        // Skip the rest of the packet in one step
+        int length = count - i;
+        if(length > request->remaining)
+          length = request->remaining;
+        keepPrefix(request, buffer + i, length);
+        request->remaining -= length;
+        i += length - 1;
+        if(request->remaining == 0 && request->chunked)
+          request->state = STATE_CHUNK_END;
+        else if(request->remaining == 0 || (!request->keepAlive && request->prefixLength == DISPATCH_PREFIX_SIZE - 1))
+          finishRequest(request, request->status);
+        break;
+      }
+      case STATE_CHUNK_SIZE:
+        if(c == '\n')
+        {
+          // A zero size chunk ends the body
+          if(request->remaining == 0)
+          {
+            request->lineLength = 0;
+            request->state = STATE_TRAILERS;
+          }
+          else
+            startBody(request);
+        }
+        else if(c == ';')
+          request->digits = 1;
+        else if(request->digits == 0 && isxdigit(c))
+        {
+          request->remaining = request->remaining * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+          if(request->remaining > 0xFFFFFFL)
+          {
+            request->keepAlive = false;
+            finishRequest(request, request->status);
+          }
+        }
+        break;
+      case STATE_CHUNK_END:
+        if(c == '\n')
+        {
+          request->remaining = 0;
+          request->digits = 0;
+          request->state = STATE_CHUNK_SIZE;
+        }
+        break;
+      case STATE_TRAILERS:
+        if(c == '\n')
+        {
+          if(request->lineLength == 0)
+            finishRequest(request, request->status);
+          request->lineLength = 0;
+        }
+        else if(c != '\r')
+          request->lineLength = 1;
+        break;
+    }
+  }
+}
+
+/**
+ * NAME: dispatchStart()
+ * DESCRIPTION: Start POSTing a payload to a set of REST Endpoints concurrently.
+ * 
+ * INPUTS:
+ *    mask        Bit mask of the REST Endpoint slots to POST to (only the enabled ones are used)
+ *    batch       True if the payload is an array of samples for the batch Save API
+ *    body        Writer for the payload to send, the data it writes must not change until dispatchPoll() returns false
+ * OUTPUTS:
+ *    False if the previous requests are still running
+ *    
+ */
+bool dispatchStart(uint8_t mask, bool batch, dispatch_body body)
+{
+  if(dispatchBusy())
+    return false;
+
+  // Close connections that the servers dropped or that have been idle too long
+  poolExpire();
+
+  // Measure the body in every payload format that is used for the Content-Length header
+  mask &= endpointsEnabled();
+  uint8_t formats = 0;
+  for(uint8_t i = 0;i < DISPATCH_MAX_REQUESTS;++i)
+  {
+    if(mask & (1 << i))
+      formats |= 1 << endpointGet(i)->format;
+  }
+  uint32_t probe = METRICS_START();
+  for(uint8_t format = 0;format < PAYLOAD_FORMATS;++format)
+  {
+    if(!(formats & (1 << format)))
+      continue;
+    CountingPrint counter;
+    body(counter, format);
+    requestLength[format] = counter.count;
+  }
+  METRICS_RECORD(METRIC_ENCODE, probe);
+  requestBatch = batch;
+  requestBody = body;
+  requestCount = DISPATCH_MAX_REQUESTS;
+  for(uint8_t i = 0;i < requestCount;++i)
+  {
+    dispatch_request *request = &requests[i];
+    request->ep = endpointGet(i);
+    request->slot = i;
+    request->conn = -1;
+    request->retried = false;
+    request->keepAlive = false;
+    request->remaining = -1;
+    request->prefixLength = 0;
+    request->status = DISPATCH_PENDING;
+    request->start = millis();
+    request->probe = METRICS_START();
+    if(!(mask & (1 << i)))
+    {
+      request->state = STATE_DONE;
+      request->status = DISPATCH_SKIPPED;
+      continue;
+    }
+    LOG_VERBOSE(F("Making POST request with HTTP basic authentication to %s\n"), request->ep->host);
+    startConnection(request);
+  }
+  return true;
+}
+
+/**
+ * NAME: dispatchPoll()
+ * DESCRIPTION: Advance every request state machine without blocking, called on every pass of the scheduler.
+ * PROCESS:   One resolving request per pass looks up its host and starts connecting (the lookup blocks so the other requests
+ *            keep moving between lookups)
+ *            Connecting requests move to sending once the NINA reports the socket established
+ *            Sending requests write the complete HTTP request
+ *            Receiving requests parse the response and return the connection to the pool
+ *            Any request that is not done after DISPATCH_TIMEOUT_MS is closed with a timeout
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True while any request is still running
+ *    
+ */
+bool dispatchPoll()
+{
+  bool busy = false;
+  bool resolved = false;
+  for(uint8_t i = 0;i < requestCount;++i)
+  {
+    dispatch_request *request = &requests[i];
+    if(request->state == STATE_DONE)
+      continue;
+
+    if(millis() - request->start > DISPATCH_TIMEOUT_MS)
+    {
+      request->keepAlive = false;
+      finishRequest(request, DISPATCH_ERROR_TIMEOUT);
+      continue;
+    }
+
+    switch(request->state)
+    {
+      case STATE_RESOLVING:
+        if(!resolved)
+        {
+          resolved = true;
+          int error = poolResolve(request->conn);
+          if(error < 0)
+            finishRequest(request, error == POOL_ERROR_DNS ? DISPATCH_ERROR_DNS : DISPATCH_ERROR_SOCKET);
+          else
+            request->state = STATE_CONNECTING;
+        }
+        break;
+      case STATE_CONNECTING:
+        if(poolConnected(request->conn))
+        {
+          METRICS_RECORD(METRIC_CONNECT(request->slot), request->connectProbe);
+          request->state = STATE_SENDING;
+        }
+        break;
+      case STATE_SENDING:
+        sendRequest(request);
+        break;
+      default:
+        receiveResponse(request);
+        break;
+    }
+    if(request->state != STATE_DONE)
+      busy = true;
+  }
+  return busy;
+}
+
+/**
+ * NAME: dispatchBusy()
+ * DESCRIPTION: Check if any request is still running.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True while any request is still running
+ *    
+ */
+bool dispatchBusy()
+{
+  for(uint8_t i = 0;i < requestCount;++i)
+  {
+    if(requests[i].state != STATE_DONE)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * NAME: dispatchStatus()
+ * DESCRIPTION: Get the result of a request.
+ * 
+ * INPUTS:
+ *    index   Index of the REST Endpoint passed to dispatchStart()
+ * OUTPUTS:
+ *    HTTP Status Code, DISPATCH_PENDING, or a negative Dispatch error code
+ *    
+ */
+int dispatchStatus(uint8_t index)
+{
+  return index < requestCount ? requests[index].status : DISPATCH_PENDING;
+}
@@ -0,0 +1,43 @@
+/**
+ * NAME: Dispatcher.h
+ * DESCRIPTION: Header file for the non-blocking HTTP POST dispatcher that sends the sensor data to all REST endpoints concurrently.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef Dispatcher_h
+#define Dispatcher_h
+
+#include <Arduino.h>
+#include "Endpoints.h"
+
+// Maximum number of concurrent requests, one per REST Endpoint slot (the NINA module supports up to 10 sockets)
+#define DISPATCH_MAX_REQUESTS ENDPOINT_SLOTS
+
+// Size of the buffer used to stream the body to the NINA module
+#define DISPATCH_WRITE_BUFFER_SIZE 64
+
+// Time allowed for each endpoint to connect and return its status line
+#define DISPATCH_TIMEOUT_MS 30000UL
+
+// Dispatch status codes returned instead of an HTTP Status Code
+#define DISPATCH_PENDING        0
+#define DISPATCH_SKIPPED        1       // Endpoint was not in the mask passed to dispatchStart() or is not enabled
+#define DISPATCH_ERROR_DNS      -1
+#define DISPATCH_ERROR_SOCKET   -2
+#define DISPATCH_ERROR_CONNECT  -3
+#define DISPATCH_ERROR_SEND     -4
+#define DISPATCH_ERROR_TIMEOUT  -5
+
+// Writes the body of the request in a payload format, called once per format to measure it and again for each REST Endpoint (must write the same bytes every time)
+typedef void (*dispatch_body)(Print &out, uint8_t format);
+
+extern bool dispatchStart(uint8_t mask, bool batch, dispatch_body body);
+extern bool dispatchPoll();
+extern bool dispatchBusy();
+extern int dispatchStatus(uint8_t index);
+
+#endif
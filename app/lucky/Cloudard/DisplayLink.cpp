@@ -0,0 +1,359 @@
+#include "DisplayLink.h"
+#include "ConnectionPool.h"
+#include "Metrics.h"
+#include "Scheduler.h"
+#include <WiFiNINA.h>
+#include "LogBuffer.h"
+
+static_assert(DISPLAY_WRITE_BUFFER_SIZE >= DISPLAY_MAX_FRAME, "The write buffer must hold the largest frame");
+
+typedef struct
+{
+  uint8_t opcode;
+  uint8_t sequence;
+  uint8_t length;
+  uint8_t args[DISPLAY_MAX_ARGS];
+} display_command;
+
+// Commands waiting to be acknowledged, the first queueSent of them have been written to the current connection
+static display_command queue[DISPLAY_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+static uint8_t queueSent = 0;
+static uint8_t nextSequence = 0;
+static unsigned int queueDropped = 0;
+
+static const char *linkHost = NULL;
+static uint16_t linkPort = 0;
+static uint8_t linkSession = 0;
+static int linkConn = -1;               // Pooled connection index (-1 = not connected)
+static bool linkUp = false;             // The connection is established and the HELLO has been sent
+static unsigned long linkDeadline = 0;  // Connect or acknowledgement deadline
+static uint32_t ackProbe = 0;           // Probe timer when the oldest unacknowledged command was sent (or the previous one acknowledged)
+static uint16_t linkBackoff = DISPLAY_BACKOFF_MIN_SECS;   // Reconnect delay in seconds
+static uint32_t linkRetry = 0;          // Scheduler tick of the next reconnect
+
+// Partial frame received from the display
+static uint8_t rxFrame[DISPLAY_MAX_FRAME];
+static uint8_t rxLength = 0;
+
+/**
+ * NAME: queueAt()
+ * DESCRIPTION: Get a queued command.
+ *
+ * INPUTS:
+ *    i   Position in the queue (0 = oldest)
+ * OUTPUTS:
+ *    The command
+ *
+ */
+static display_command *queueAt(uint8_t i)
+{
+  return &queue[(queueHead + i) % DISPLAY_QUEUE_SIZE];
+}
+
+/**
+ * NAME: linkFailed()
+ * DESCRIPTION: Close the connection and schedule the next connection attempt after the backoff delay.
+ * PROCESS:   Every unacknowledged command is sent again on the next connection (the display ignores the ones it already processed)
+ *
+ * INPUTS:
+ *    reason    Reason for the log
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void linkFailed(const __FlashStringHelper *reason)
+{
+  if(linkConn >= 0)
+    poolFail(linkConn);
+  linkConn = -1;
+  linkUp = false;
+  queueSent = 0;
+  rxLength = 0;
+  LOG_VERBOSE(F("Remote LED Display %S, retrying in %d s\n"), reason, linkBackoff);
+  linkRetry = schedulerTicks() + SECONDS_TO_TICKS(linkBackoff);
+  linkBackoff = min(linkBackoff * 2, DISPLAY_BACKOFF_MAX_SECS);
+}
+
+/**
+ * NAME: writeFrame()
+ * DESCRIPTION: Append a command frame to a buffer.
+ *
+ * INPUTS:
+ *    buffer      The buffer (must have room for the frame)
+ *    opcode      Command opcode
+ *    sequence    Command sequence number
+ *    args        Command arguments
+ *    length      Number of arguments
+ * OUTPUTS:
+ *    Number of bytes appended
+ *
+ */
+static uint8_t writeFrame(uint8_t *buffer, uint8_t opcode, uint8_t sequence, const uint8_t *args, uint8_t length)
+{
+  buffer[0] = DISPLAY_FRAME_START;
+  buffer[1] = length + 2;
+  buffer[2] = opcode;
+  buffer[3] = sequence;
+  memcpy(buffer + DISPLAY_FRAME_HEADER, args, length);
+  return DISPLAY_FRAME_HEADER + length;
+}
+
+/**
+ * NAME: sendCommands()
+ * DESCRIPTION: Send the HELLO of a new connection and the commands not yet sent on it.
+ * PROCESS:   The frames are pipelined into as few writes as possible (a write whenever the next frame does not fit the buffer)
+ *            The acknowledgement deadline starts when nothing was outstanding
+ *
+ * INPUTS:
+ *    hello   True to send the HELLO frame first
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void sendCommands(bool hello)
+{
+  WiFiClient client = poolClient(linkConn);
+  uint8_t buffer[DISPLAY_WRITE_BUFFER_SIZE];
+  uint8_t length = 0;
+  if(hello)
+    length += writeFrame(buffer, DISPLAY_OP_HELLO, nextSequence, &linkSession, 1);
+  if(queueSent == 0 && queueCount != 0)
+  {
+    linkDeadline = millis() + DISPLAY_ACK_TIMEOUT_MS;
+    ackProbe = METRICS_START();
+  }
+  for(;queueSent < queueCount;++queueSent)
+  {
+    display_command *command = queueAt(queueSent);
+    if(length + DISPLAY_FRAME_HEADER + command->length > sizeof(buffer))
+    {
+      if(client.write(buffer, length) != length)
+      {
+        linkFailed(F("write failed"));
+        return;
+      }
+      length = 0;
+    }
+    length += writeFrame(buffer + length, command->opcode, command->sequence, command->args, command->length);
+  }
+  if(length != 0 && client.write(buffer, length) != length)
+    linkFailed(F("write failed"));
+}
+
+/**
+ * NAME: acknowledge()
+ * DESCRIPTION: Remove the commands acknowledged by the display from the queue.
+ *
+ * INPUTS:
+ *    sequence    Sequence number of the last command processed by the display
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void acknowledge(uint8_t sequence)
+{
+  bool progress = false;
+  while(queueSent != 0 && (int8_t)(sequence - queue[queueHead].sequence) >= 0)
+  {
+    queueHead = (queueHead + 1) % DISPLAY_QUEUE_SIZE;
+    --queueCount;
+    --queueSent;
+    progress = true;
+  }
+  if(progress)
+  {
+    linkDeadline = millis() + DISPLAY_ACK_TIMEOUT_MS;
+    METRICS_RECORD(METRIC_DISPLAY, ackProbe);
+    ackProbe = METRICS_START();
+  }
+}
+
+/**
+ * NAME: receiveFrames()
+ * DESCRIPTION: Read the frames sent by the display (bytes outside a frame are skipped).
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void receiveFrames()
+{
+  WiFiClient client = poolClient(linkConn);
+  uint8_t data[16];
+  int count;
+  while(client.available() > 0 && (count = client.read(data, sizeof(data))) > 0)
+  {
+    for(int i = 0;i < count;++i)
+    {
+      if(rxLength == 0 && data[i] != DISPLAY_FRAME_START)
+        continue;
+      rxFrame[rxLength++] = data[i];
+      if(rxLength == 2 && (rxFrame[1] < 2 || rxFrame[1] > DISPLAY_MAX_FRAME - 2))
+        rxLength = 0;
+      else if(rxLength > 2 && rxLength == rxFrame[1] + 2)
+      {
+        if(rxFrame[2] == DISPLAY_OP_ACK)
+          acknowledge(rxFrame[3]);
+        rxLength = 0;
+      }
+    }
+  }
+}
+
+/**
+ * NAME: displayLinkBegin()
+ * DESCRIPTION: Set the address of the Remote LED Display (the connection is opened when the first command is sent).
+ * PROCESS:   The session number sent in the HELLO is taken from the time it took to start up and connect to WiFi so that it changes after every reset
+ *
+ * INPUTS:
+ *    host    The Remote LED Display IP address (must stay allocated)
+ *    port    The Remote LED Display port
+ * OUTPUTS:
+ *    None
+ *
+ */
+void displayLinkBegin(const char *host, uint16_t port)
+{
+  linkHost = host;
+  linkPort = port;
+  linkSession = (uint8_t)(micros() >> 2);
+}
+
+/**
+ * NAME: displayLinkSend()
+ * DESCRIPTION: Queue a command for the Remote LED Display, it is sent by displayLinkPoll() and sent again after a reconnect until it is acknowledged.
+ *
+ * INPUTS:
+ *    opcode    Command opcode
+ *    args      Command arguments
+ *    length    Number of arguments (at most DISPLAY_MAX_ARGS)
+ * OUTPUTS:
+ *    False if the oldest command had to be dropped to make room
+ *
+ */
+bool displayLinkSend(uint8_t opcode, const uint8_t *args, uint8_t length)
+{
+  bool dropped = false;
+  if(queueCount == DISPLAY_QUEUE_SIZE)
+  {
+    queueHead = (queueHead + 1) % DISPLAY_QUEUE_SIZE;
+    --queueCount;
+    if(queueSent != 0)
+      --queueSent;
+    ++queueDropped;
+    dropped = true;
+    LOG_VERBOSE(F("Remote LED Display queue full, %d commands dropped\n"), queueDropped);
+  }
+  display_command *command = queueAt(queueCount++);
+  command->opcode = opcode;
+  command->sequence = nextSequence++;
+  command->length = min(length, (uint8_t)DISPLAY_MAX_ARGS);
+  memcpy(command->args, args, command->length);
+  return !dropped;
+}
+
+/**
+ * NAME: displayLinkPoll()
+ * DESCRIPTION: Keep the connection to the Remote LED Display open and deliver the queued commands (never blocks).
+ * PROCESS:   While there are commands and the backoff delay has passed open a pooled connection without waiting for it
+ *            Once established send the HELLO and every queued command in one write
+ *            Read the acknowledgements and send any commands queued since
+ *            Close and reconnect (with a doubling backoff) if the display closes the connection or an acknowledgement is late
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void displayLinkPoll()
+{
+  if(linkHost == NULL)
+    return;
+
+  // Connect once there is something to send
+  if(linkConn < 0)
+  {
+    if(queueCount == 0 || WiFi.status() != WL_CONNECTED || (int32_t)(schedulerTicks() - linkRetry) < 0)
+      return;
+    bool reused;
+    linkConn = poolAcquire(linkHost, linkPort, &reused);
+    if(linkConn < 0)
+    {
+      linkConn = -1;
+      linkFailed(F("has no socket"));
+      return;
+    }
+    linkDeadline = millis() + DISPLAY_CONNECT_TIMEOUT_MS;
+    return;
+  }
+
+  // Resolve the host on the pass after the connection was acquired, then wait for the connection to be established
+  if(!linkUp)
+  {
+    if(poolResolving(linkConn))
+    {
+      if(poolResolve(linkConn) < 0)
+        linkFailed(F("could not be resolved"));
+    }
+    else if(poolConnected(linkConn))
+    {
+      LOG_VERBOSE(F("Connected to Remote LED Display %s\n"), linkHost);
+      linkUp = true;
+      linkBackoff = DISPLAY_BACKOFF_MIN_SECS;
+      sendCommands(true);
+    }
+    else if((long)(millis() - linkDeadline) >= 0)
+    {
+      linkFailed(F("did not connect"));
+    }
+    return;
+  }
+
+  // Read the acknowledgements and send the new commands
+  if(!poolConnected(linkConn))
+  {
+    linkFailed(F("closed the connection"));
+    return;
+  }
+  receiveFrames();
+  if(queueSent < queueCount)
+    sendCommands(false);
+  if(linkConn >= 0 && queueSent != 0 && (long)(millis() - linkDeadline) >= 0)
+    linkFailed(F("did not acknowledge"));
+}
+
+/**
+ * NAME: displayLinkConnected()
+ * DESCRIPTION: Check if the connection to the Remote LED Display is established.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True if connected
+ *
+ */
+bool displayLinkConnected()
+{
+  return linkUp;
+}
+
+/**
+ * NAME: displayLinkBusy()
+ * DESCRIPTION: Check if the link is waiting to connect or for an acknowledgement (the millis() deadline must keep running).
+ *              Commands queued while the Remote LED Display is offline do not keep the CPU awake, the reconnect is timed in ticks.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    True if a connect or acknowledgement deadline is running
+ *
+ */
+bool displayLinkBusy()
+{
+  return linkConn >= 0 && (!linkUp || queueSent != 0);
+}
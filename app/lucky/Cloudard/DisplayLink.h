@@ -0,0 +1,37 @@
+/**
+ * NAME: DisplayLink.h
+ * DESCRIPTION: Header file for the persistent connection that sends binary command frames to the Remote LED Display (see DisplayProtocol.h).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef DisplayLink_h
+#define DisplayLink_h
+
+#include <Arduino.h>
+#include "DisplayProtocol.h"
+
+// Number of commands kept until they are acknowledged (the oldest command is dropped when full)
+#define DISPLAY_QUEUE_SIZE 8
+
+// Size of the buffer the pipelined frames are collected in before they are written to the NINA module (must hold the largest frame)
+#define DISPLAY_WRITE_BUFFER_SIZE 64
+
+// Time allowed to connect and to get the acknowledgement of the oldest command sent before the connection is closed and opened again
+#define DISPLAY_CONNECT_TIMEOUT_MS 5000UL
+#define DISPLAY_ACK_TIMEOUT_MS 5000UL
+
+// Delay in seconds before reconnecting, doubled after every failure up to the maximum (timed in scheduler ticks so it runs in standby)
+#define DISPLAY_BACKOFF_MIN_SECS 1
+#define DISPLAY_BACKOFF_MAX_SECS 60
+
+extern void displayLinkBegin(const char *host, uint16_t port);
+extern bool displayLinkSend(uint8_t opcode, const uint8_t *args, uint8_t length);
+extern void displayLinkPoll();
+extern bool displayLinkConnected();
+extern bool displayLinkBusy();
+
+#endif
@@ -0,0 +1,54 @@
+/**
+ * NAME: DisplayProtocol.h
+ * DESCRIPTION: Binary command frames sent over the persistent connection between Cloudard and the IotDisplay
+ *              (the same file is in both sketches and the two copies must be kept identical).
+ *
+ *              Frame:  START  LENGTH  OPCODE  SEQUENCE  ARGS...
+ *                      START is DISPLAY_FRAME_START (never a printable character, so the display can still accept the legacy "LED=COLOR\n" text commands)
+ *                      LENGTH counts the bytes after it (OPCODE, SEQUENCE and the ARGS)
+ *                      SEQUENCE is incremented for every command and wraps at 256
+ *
+ *              Several frames can be written at once (pipelined).  The display answers with a DISPLAY_OP_ACK frame whose SEQUENCE is the
+ *              last command it processed, which acknowledges that command and every command before it.  Commands that are not acknowledged are
+ *              sent again on the next connection and the display skips the ones with a SEQUENCE it has already processed in the same session.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef DisplayProtocol_h
+#define DisplayProtocol_h
+
+// History point: timestamp (uint32_t epoch seconds, 0 = unknown), temperature (int16_t hundredths of a degree F),
+// pressure (uint16_t hundredths of an inHg), humidity (uint16_t hundredths of a %), all little endian
+#define DISPLAY_POINT_SIZE      10
+#define DISPLAY_MAX_POINTS      4
+
+// Frame layout
+#define DISPLAY_FRAME_START     0xA5
+#define DISPLAY_FRAME_HEADER    4       // START, LENGTH, OPCODE, SEQUENCE
+#define DISPLAY_MAX_ARGS        (1 + DISPLAY_MAX_POINTS * DISPLAY_POINT_SIZE)
+#define DISPLAY_MAX_FRAME       (DISPLAY_FRAME_HEADER + DISPLAY_MAX_ARGS)
+
+// Opcodes
+#define DISPLAY_OP_HELLO        0x01    // ARGS: session (sent first on every connection and not acknowledged, a new session resets the duplicate check on the display)
+#define DISPLAY_OP_LED          0x02    // ARGS: color (display the next LED)
+#define DISPLAY_OP_CLEAR        0x03    // ARGS: none (clear the LED's)
+#define DISPLAY_OP_HISTORY      0x04    // ARGS: count, count history points (oldest first, added to the chart)
+#define DISPLAY_OP_VIEW         0x05    // ARGS: view (show the LED's or the chart)
+#define DISPLAY_OP_ACK          0x80    // ARGS: none (display to Cloudard, SEQUENCE is the last command processed)
+
+// LED colors
+#define DISPLAY_COLOR_BLACK     0
+#define DISPLAY_COLOR_PURPLE    1
+#define DISPLAY_COLOR_RED       2
+#define DISPLAY_COLOR_YELLOW    3
+#define DISPLAY_COLOR_WHITE     4
+
+// Views
+#define DISPLAY_VIEW_LEDS       0
+#define DISPLAY_VIEW_CHART      1
+
+#endif
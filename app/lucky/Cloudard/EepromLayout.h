@@ -0,0 +1,30 @@
+/**
+ * NAME: EepromLayout.h
+ * DESCRIPTION: Allocation of the 256 byte ATmega4809 EEPROM between the application modules.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef EepromLayout_h
+#define EepromLayout_h
+
+// Configuration Settings written by writeConfiguration() (flag, SSID, SSID Password, Display IP Address)
+#define EEPROM_CONFIG_ADDRESS       0
+#define EEPROM_CONFIG_SIZE          72
+
+// Cached BME280 calibration data (chip ID, coefficients, checksum)
+#define EEPROM_CALIBRATION_ADDRESS  (EEPROM_CONFIG_ADDRESS + EEPROM_CONFIG_SIZE)
+#define EEPROM_CALIBRATION_SIZE     36
+
+// Store-and-forward queue of samples that could not be POSTed (11 byte records, see PostQueue.h)
+#define EEPROM_QUEUE_ADDRESS        (EEPROM_CALIBRATION_ADDRESS + EEPROM_CALIBRATION_SIZE)
+#define EEPROM_QUEUE_SIZE           77
+
+// REST Endpoint overrides set from the Configuration Page (see Endpoints.h)
+#define EEPROM_ENDPOINT_ADDRESS     (EEPROM_QUEUE_ADDRESS + EEPROM_QUEUE_SIZE)
+#define EEPROM_ENDPOINT_SIZE        71
+
+#endif
@@ -0,0 +1,243 @@
+#include "Endpoints.h"
+#include <EEPROM.h>
+
+// EEPROM override record: magic, enabled slot mask, override slot (0xFF = none), format, port, host and path null terminated
+#define ENDPOINT_MAGIC            0xE5
+#define ENDPOINT_OFFSET_ENABLED   1
+#define ENDPOINT_OFFSET_SLOT      2
+#define ENDPOINT_OFFSET_FORMAT    3
+#define ENDPOINT_OFFSET_PORT      4
+#define ENDPOINT_OFFSET_STRINGS   6
+#define ENDPOINT_NO_SLOT          0xFF
+
+static const endpoint_default *defaultEndpoints = NULL;
+static uint8_t defaultCount = 0;
+static endpoint endpoints[ENDPOINT_SLOTS];
+static uint8_t enabled = 0;
+static int8_t overrideSlot = -1;
+static int overridePathAddress = 0;
+
+/**
+ * NAME: readString()
+ * DESCRIPTION: Read a null terminated string from the endpoint override record.
+ * 
+ * INPUTS:
+ *    address   EEPROM address of the string
+ *    buffer    Buffer for the string (always null terminated)
+ *    size      Size of the buffer
+ * OUTPUTS:
+ *    EEPROM address after the null terminator
+ *    
+ */
+static int readString(int address, char *buffer, size_t size)
+{
+  size_t length = 0;
+  int end = EEPROM_ENDPOINT_ADDRESS + EEPROM_ENDPOINT_SIZE;
+  while(address < end)
+  {
+    char c = EEPROM.read(address++);
+    if(c == '\0')
+      break;
+    if(length < size - 1)
+      buffer[length++] = c;
+  }
+  buffer[length] = '\0';
+  return address;
+}
+
+/**
+ * NAME: writeString()
+ * DESCRIPTION: Write a null terminated string to the endpoint override record (only the bytes that changed are written).
+ * 
+ * INPUTS:
+ *    address   EEPROM address of the string
+ *    s         The string
+ * OUTPUTS:
+ *    EEPROM address after the null terminator
+ *    
+ */
+static int writeString(int address, const char *s)
+{
+  do
+  {
+    EEPROM.update(address++, *s);
+  } while(*s++ != '\0');
+  return address;
+}
+
+/**
+ * NAME: endpointsBegin()
+ * DESCRIPTION: Load the REST endpoints from the defaults and the overrides saved in EEPROM.
+ * PROCESS:   Each slot starts with its default (slots without a default are empty)
+ *            If the EEPROM holds an override record it selects the enabled slots and may replace one slot
+ *            Empty slots are never enabled
+ * 
+ * INPUTS:
+ *    defaults    Table of default REST Endpoints in PROGMEM
+ *    count       Number of default REST Endpoints (at most ENDPOINT_SLOTS are used)
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void endpointsBegin(const endpoint_default *defaults, uint8_t count)
+{
+  defaultEndpoints = defaults;
+  defaultCount = count < ENDPOINT_SLOTS ? count : ENDPOINT_SLOTS;
+  enabled = 0;
+  overrideSlot = -1;
+  for(uint8_t i = 0;i < ENDPOINT_SLOTS;++i)
+  {
+    endpoint *ep = &endpoints[i];
+    ep->host[0] = '\0';
+    if(i >= defaultCount)
+      continue;
+    const endpoint_default *def = &defaults[i];
+    strncpy_P(ep->host, (PGM_P)pgm_read_ptr(&def->host), sizeof(ep->host) - 1);
+    ep->host[sizeof(ep->host) - 1] = '\0';
+    ep->port = pgm_read_word(&def->port);
+    ep->format = pgm_read_byte(&def->format);
+    enabled |= 1 << i;
+  }
+
+  // Apply the overrides from the Configuration Page
+  if(EEPROM.read(EEPROM_ENDPOINT_ADDRESS) == ENDPOINT_MAGIC)
+  {
+    enabled = EEPROM.read(EEPROM_ENDPOINT_ADDRESS + ENDPOINT_OFFSET_ENABLED);
+    uint8_t slot = EEPROM.read(EEPROM_ENDPOINT_ADDRESS + ENDPOINT_OFFSET_SLOT);
+    if(slot < ENDPOINT_SLOTS)
+    {
+      endpoint *ep = &endpoints[slot];
+      overrideSlot = slot;
+      ep->format = EEPROM.read(EEPROM_ENDPOINT_ADDRESS + ENDPOINT_OFFSET_FORMAT) == PAYLOAD_CBOR ? PAYLOAD_CBOR : PAYLOAD_JSON;
+      uint16_t port;
+      ep->port = EEPROM.get(EEPROM_ENDPOINT_ADDRESS + ENDPOINT_OFFSET_PORT, port);
+      overridePathAddress = readString(EEPROM_ENDPOINT_ADDRESS + ENDPOINT_OFFSET_STRINGS, ep->host, sizeof(ep->host));
+    }
+  }
+  for(uint8_t i = 0;i < ENDPOINT_SLOTS;++i)
+  {
+    if(endpoints[i].host[0] == '\0')
+      enabled &= ~(1 << i);
+  }
+  enabled &= (1 << ENDPOINT_SLOTS) - 1;
+}
+
+/**
+ * NAME: endpointsEnabled()
+ * DESCRIPTION: Get the REST endpoints the sensor data is POSTed to.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Bit mask of the enabled slots (bit 0 = slot 0)
+ *    
+ */
+uint8_t endpointsEnabled()
+{
+  return enabled;
+}
+
+/**
+ * NAME: endpointGet()
+ * DESCRIPTION: Get the host, port, and payload format of a REST endpoint.
+ * 
+ * INPUTS:
+ *    slot    The slot
+ * OUTPUTS:
+ *    The REST Endpoint or NULL if the slot is empty
+ *    
+ */
+const endpoint *endpointGet(uint8_t slot)
+{
+  if(slot >= ENDPOINT_SLOTS || endpoints[slot].host[0] == '\0')
+    return NULL;
+  return &endpoints[slot];
+}
+
+/**
+ * NAME: endpointPath()
+ * DESCRIPTION: Copy the Save API path of a REST endpoint from flash or EEPROM.
+ * 
+ * INPUTS:
+ *    slot    The slot
+ *    buffer  Buffer for the path (always null terminated)
+ *    size    Size of the buffer
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void endpointPath(uint8_t slot, char *buffer, size_t size)
+{
+  buffer[0] = '\0';
+  if(slot == overrideSlot)
+  {
+    readString(overridePathAddress, buffer, size);
+  }
+  else if(slot < defaultCount)
+  {
+    strncpy_P(buffer, (PGM_P)pgm_read_ptr(&defaultEndpoints[slot].path), size - 1);
+    buffer[size - 1] = '\0';
+  }
+}
+
+/**
+ * NAME: endpointAuth()
+ * DESCRIPTION: Get the Basic Authentication credentials of a REST endpoint.
+ * PROCESS:   Only the defaults have credentials, an override is a host entered on the Configuration Page and must never be sent
+ *            the credentials of another REST endpoint (the EEPROM has no room to store its own)
+ * 
+ * INPUTS:
+ *    slot    The slot
+ * OUTPUTS:
+ *    Base64 credentials in PROGMEM or NULL to send no Authorization header
+ *    
+ */
+PGM_P endpointAuth(uint8_t slot)
+{
+  if(slot == overrideSlot || slot >= defaultCount)
+    return NULL;
+  return (PGM_P)pgm_read_ptr(&defaultEndpoints[slot].auth);
+}
+
+/**
+ * NAME: endpointsConfigure()
+ * DESCRIPTION: Save the REST endpoint overrides to EEPROM and apply them.
+ * PROCESS:   The enabled slots are always saved, a rejected override leaves the previously saved override in place
+ * 
+ * INPUTS:
+ *    enabledMask Bit mask of the enabled slots
+ *    slot        The slot to replace with the host, port, path, and format or -1 to use the defaults for every slot
+ *    host        The REST API Endpoint server domain address
+ *    port        The REST API Endpoint server Port
+ *    path        The Save API path
+ *    format      PAYLOAD_JSON or PAYLOAD_CBOR
+ * OUTPUTS:
+ *    False if the override was rejected because the slot or port is invalid or the host and path do not fit
+ *    
+ */
+bool endpointsConfigure(uint8_t enabledMask, int8_t slot, const char *host, uint16_t port, const char *path, uint8_t format)
+{
+  int address = EEPROM_ENDPOINT_ADDRESS;
+  bool valid = true;
+  if(slot >= 0)
+  {
+    size_t hostLength = strlen(host);
+    size_t pathLength = strlen(path);
+    valid = slot < ENDPOINT_SLOTS && port != 0 && hostLength != 0 && hostLength < ENDPOINT_HOST_SIZE && pathLength < ENDPOINT_PATH_SIZE &&
+            ENDPOINT_OFFSET_STRINGS + hostLength + 1 + pathLength + 1 <= EEPROM_ENDPOINT_SIZE;
+    if(valid)
+    {
+      EEPROM.update(address + ENDPOINT_OFFSET_FORMAT, format);
+      EEPROM.put(address + ENDPOINT_OFFSET_PORT, port);
+      writeString(writeString(address + ENDPOINT_OFFSET_STRINGS, host), path);
+    }
+  }
+  EEPROM.update(address + ENDPOINT_OFFSET_ENABLED, enabledMask);
+  if(valid)
+    EEPROM.update(address + ENDPOINT_OFFSET_SLOT, slot >= 0 ? slot : ENDPOINT_NO_SLOT);
+  else if(EEPROM.read(address) != ENDPOINT_MAGIC)
+    EEPROM.update(address + ENDPOINT_OFFSET_SLOT, ENDPOINT_NO_SLOT);
+  EEPROM.update(address, ENDPOINT_MAGIC);
+  endpointsBegin(defaultEndpoints, defaultCount);
+  return valid;
+}
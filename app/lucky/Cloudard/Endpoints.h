@@ -0,0 +1,57 @@
+/**
+ * NAME: Endpoints.h
+ * DESCRIPTION: Header file for the registry of REST endpoints the sensor data is POSTed to.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef Endpoints_h
+#define Endpoints_h
+
+#include <Arduino.h>
+#include "EepromLayout.h"
+
+// Number of REST endpoint slots
+#define ENDPOINT_SLOTS      4
+
+// Longest host name and path (including the null terminator)
+#define ENDPOINT_HOST_SIZE  48
+#define ENDPOINT_PATH_SIZE  40
+
+// The batch Save API is the Save API path with this suffix
+#define ENDPOINT_BATCH_SUFFIX "batch"
+
+// Payload formats a REST Endpoint accepts
+#define PAYLOAD_JSON      0       // application/json
+#define PAYLOAD_CBOR      1       // application/cbor
+#define PAYLOAD_FORMATS   2
+
+// Default REST Endpoint compiled into the sketch (the table and all its strings are in PROGMEM)
+typedef struct
+{
+  const char *host;
+  const char *path;       // Save API for a single sample
+  const char *auth;       // Basic Authentication credentials in Base64
+  uint16_t port;
+  uint8_t format;         // PAYLOAD_JSON or PAYLOAD_CBOR
+} endpoint_default;
+
+// Active REST Endpoint (only the host is kept in RAM, for name resolution and the connection pool)
+typedef struct
+{
+  char host[ENDPOINT_HOST_SIZE];
+  uint16_t port;
+  uint8_t format;
+} endpoint;
+
+extern void endpointsBegin(const endpoint_default *defaults, uint8_t count);
+extern uint8_t endpointsEnabled();
+extern const endpoint *endpointGet(uint8_t slot);
+extern void endpointPath(uint8_t slot, char *buffer, size_t size);
+extern PGM_P endpointAuth(uint8_t slot);
+extern bool endpointsConfigure(uint8_t enabledMask, int8_t slot, const char *host, uint16_t port, const char *path, uint8_t format);
+
+#endif
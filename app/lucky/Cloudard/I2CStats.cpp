@@ -0,0 +1,48 @@
+#include "I2CStats.h"
+
+i2c_stats i2cStats = { 0, 0, 0 };
+
+/**
+ * NAME: i2cStatsRecord()
+ * DESCRIPTION: Record one register access on the I2C bus.
+ * PROCESS:   A register write is START, address, register, data bytes, STOP
+ *            A register read is START, address, register, STOP followed by START, address, data bytes, STOP
+ *            Every byte is 9 bits (8 data bits and ACK) and START/STOP are counted as 1 bit each
+ * 
+ * INPUTS:
+ *    written   Number of data bytes written after the register byte
+ *    read      Number of data bytes read back
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void i2cStatsRecord(uint8_t written, uint8_t read)
+{
+  uint8_t bytes = 2 + written;
+  uint8_t bits = 2;
+  if(read)
+  {
+    bytes += 1 + read;
+    bits += 2;
+  }
+  ++i2cStats.transactions;
+  i2cStats.bytes += bytes;
+  i2cStats.busTimeUs += ((bytes * 9UL + bits) * 1000000UL) / I2C_STATS_CLOCK_HZ;
+}
+
+/**
+ * NAME: i2cStatsReset()
+ * DESCRIPTION: Clear the I2C bus counters before measuring a driver call.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void i2cStatsReset()
+{
+  i2cStats.transactions = 0;
+  i2cStats.bytes = 0;
+  i2cStats.busTimeUs = 0;
+}
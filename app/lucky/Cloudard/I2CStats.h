@@ -0,0 +1,43 @@
+/**
+ * NAME: I2CStats.h
+ * DESCRIPTION: Header file for the I2C bus accounting used to measure the bus budget of the Lucky Shield drivers.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef I2CStats_h
+#define I2CStats_h
+
+#include <Arduino.h>
+
+// Set this to 1 to count the I2C traffic generated by the BME280 and CAT9555 drivers
+#ifndef I2C_STATS
+#define I2C_STATS 0
+#endif
+
+// I2C bus clock used to estimate the bus time (Wire default)
+#define I2C_STATS_CLOCK_HZ 100000UL
+
+typedef struct
+{
+  uint16_t transactions;    // Register accesses (a register read counts as one)
+  uint16_t bytes;           // Bytes on the wire including address and register bytes
+  uint32_t busTimeUs;       // Estimated bus time in microseconds
+} i2c_stats;
+
+#if I2C_STATS
+  #define I2C_STATS_WRITE(count) i2cStatsRecord((count), 0)
+  #define I2C_STATS_READ(count) i2cStatsRecord(0, (count))
+#else
+  #define I2C_STATS_WRITE(count)
+  #define I2C_STATS_READ(count)
+#endif
+
+extern i2c_stats i2cStats;
+extern void i2cStatsRecord(uint8_t written, uint8_t read);
+extern void i2cStatsReset();
+
+#endif
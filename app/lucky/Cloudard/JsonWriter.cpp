@@ -0,0 +1,149 @@
+#include "JsonWriter.h"
+
+/*!
+ *  @brief  Create a writer
+ *  @param  out the Print the JSON is written to
+ */
+JsonWriter::JsonWriter(Print &out) : out(out), depth(0), empty(1) {}
+
+/*!
+ *  @brief  Start a JSON object, as the top level value or as the next member of an array
+ */
+void JsonWriter::beginObject()
+{
+  begin('{');
+}
+
+/*!
+ *  @brief  Start a JSON object as a member of the current object
+ *  @param  name the member name (must not need escaping)
+ */
+void JsonWriter::beginObject(const __FlashStringHelper *name)
+{
+  this->name(name);
+  open('{');
+}
+
+/*!
+ *  @brief  End the current JSON object
+ */
+void JsonWriter::endObject()
+{
+  end('}');
+}
+
+/*!
+ *  @brief  Start a JSON array, as the top level value or as the next member of an array
+ */
+void JsonWriter::beginArray()
+{
+  begin('[');
+}
+
+/*!
+ *  @brief  Start a JSON array as a member of the current object
+ *  @param  name the member name (must not need escaping)
+ */
+void JsonWriter::beginArray(const __FlashStringHelper *name)
+{
+  this->name(name);
+  open('[');
+}
+
+/*!
+ *  @brief  End the current JSON array
+ */
+void JsonWriter::endArray()
+{
+  end(']');
+}
+
+/*!
+ *  @brief  Write an integer member of the current object
+ *  @param  name the member name (must not need escaping)
+ *  @param  value the value
+ */
+void JsonWriter::field(const __FlashStringHelper *name, long value)
+{
+  this->name(name);
+  number(value, 0);
+}
+
+/*!
+ *  @brief  Write a fixed point member of the current object
+ *  @param  name the member name (must not need escaping)
+ *  @param  value the value scaled by 10^decimals (e.g. 7245 with 2 decimals is written as 72.45)
+ *  @param  decimals number of decimal places
+ */
+void JsonWriter::fieldFixed(const __FlashStringHelper *name, long value, uint8_t decimals)
+{
+  this->name(name);
+  number(value, decimals);
+}
+
+/*!
+ *  @brief  Write an integer member of the current array
+ *  @param  value the value
+ */
+void JsonWriter::value(long value)
+{
+  separator();
+  number(value, 0);
+}
+
+void JsonWriter::separator()
+{
+  if(!(empty & (1 << depth)))
+    out.write(',');
+  empty &= ~(1 << depth);
+}
+
+void JsonWriter::begin(char c)
+{
+  separator();
+  open(c);
+}
+
+void JsonWriter::open(char c)
+{
+  if(depth < JSON_MAX_DEPTH - 1)
+    ++depth;
+  empty |= 1 << depth;
+  out.write(c);
+}
+
+void JsonWriter::end(char c)
+{
+  if(depth > 0)
+    --depth;
+  out.write(c);
+}
+
+void JsonWriter::name(const __FlashStringHelper *name)
+{
+  separator();
+  out.write('"');
+  out.print(name);
+  out.write('"');
+  out.write(':');
+}
+
+void JsonWriter::number(long value, uint8_t decimals)
+{
+  // Format right to left into a buffer big enough for a long with a sign and a decimal point
+  char buffer[13];
+  char *p = buffer + sizeof(buffer);
+  unsigned long magnitude = value < 0 ? -(unsigned long)value : value;
+  uint8_t digits = 0;
+  do
+  {
+    if(digits == decimals && decimals != 0)
+      *--p = '.';
+    *--p = '0' + magnitude % 10;
+    magnitude /= 10;
+    ++digits;
+  } while(magnitude != 0 || digits <= decimals);
+  if(value < 0)
+    *--p = '-';
+  out.write((const uint8_t *)p, buffer + sizeof(buffer) - p);
+}
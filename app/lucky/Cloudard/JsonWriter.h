@@ -0,0 +1,56 @@
+/**
+ * NAME: JsonWriter.h
+ * DESCRIPTION: Header file for the streaming JSON writer that formats JSON directly to any Print without using the heap.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef JsonWriter_h
+#define JsonWriter_h
+
+#include <Arduino.h>
+
+// Deepest nesting of JSON objects and arrays
+#define JSON_MAX_DEPTH 8
+
+class JsonWriter
+{
+  public:
+    JsonWriter(Print &out);
+    void beginObject();
+    void beginObject(const __FlashStringHelper *name);
+    void endObject();
+    void beginArray();
+    void beginArray(const __FlashStringHelper *name);
+    void endArray();
+    void field(const __FlashStringHelper *name, long value);
+    void fieldFixed(const __FlashStringHelper *name, long value, uint8_t decimals);
+    void value(long value);
+
+  private:
+    Print &out;
+    uint8_t depth;
+    uint8_t empty;        // Bit per nesting level set until the first member is written
+
+    void separator();
+    void begin(char c);
+    void open(char c);
+    void end(char c);
+    void name(const __FlashStringHelper *name);
+    void number(long value, uint8_t decimals);
+};
+
+// Print that only counts the bytes written to it (used to get the Content-Length before streaming a body)
+class CountingPrint : public Print
+{
+  public:
+    CountingPrint() : count(0) {}
+    size_t write(uint8_t c) { ++count; return 1; }
+    size_t write(const uint8_t *buffer, size_t size) { count += size; return size; }
+    size_t count;
+};
+
+#endif
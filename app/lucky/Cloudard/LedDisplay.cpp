@@ -0,0 +1,25 @@
+#include "LedDisplay.h"
+#include "Lucky.h"
+
+/**
+ * NAME: displayLED()
+ * DESCRIPTION: Utility method to update the LED Display.
+ * PROCESS:   Bit 0 of input value is displayed on LED1
+ *            Bit 1 of input value is displayed on LED2
+ * 
+ * INPUTS:
+ *    int value   The count to take 2 bits from for the LED Display
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void displayLED(int value)
+{
+  // Display values as a 2 bit binary value on LED1 and LED2 using a single write
+  uint16_t leds = 0;
+  if(value & 0x01)
+    leds |= LED1;
+  if(value & 0x02)
+    leds |= LED2;
+  lucky.gpio().writePins(LED1 | LED2, leds);
+}
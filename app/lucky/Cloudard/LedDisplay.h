@@ -0,0 +1,18 @@
+/**
+ * NAME: LedDisplay.h
+ * DESCRIPTION: Header file for the LED Display (LED1 and LED2 of the Lucky Shield).
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef LedDisplay_h
+#define LedDisplay_h
+
+#include <Arduino.h>
+
+extern void displayLED(int value);
+
+#endif
@@ -0,0 +1,177 @@
+#include "LogBuffer.h"
+#include <avr/interrupt.h>
+
+static_assert((LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0 && LOG_BUFFER_SIZE <= 256, "The log buffer size must be a power of 2 up to 256");
+
+LogBuffer logBuffer;
+
+/*!
+ *  @brief  Create an empty log buffer (nothing is drained until begin() is called)
+ */
+LogBuffer::LogBuffer() : out(NULL), head(0), tail(0), droppedBytes(0), droppedReported(0), blocking(false) {}
+
+/*!
+ *  @brief  Set the serial port the log is drained to
+ *  @param  out the serial port (already started)
+ */
+void LogBuffer::begin(HardwareSerial &out)
+{
+  this->out = &out;
+}
+
+/*!
+ *  @brief  Add a byte to the ring buffer (interrupts must be disabled)
+ *  @param  c the byte
+ *  @return False if the buffer is full and the byte was dropped
+ */
+bool LogBuffer::push(uint8_t c)
+{
+  if((uint16_t)(head - tail) >= LOG_BUFFER_SIZE)
+  {
+    if(droppedBytes != 0xFFFF)
+      ++droppedBytes;
+    return false;
+  }
+  buffer[head % LOG_BUFFER_SIZE] = c;
+  ++head;
+  return true;
+}
+
+/*!
+ *  @brief  Add a byte to the log without waiting (safe from an Interrupt Service Routine unless blocking is set)
+ *  @param  c the byte
+ *  @return 1, or 0 if the buffer is full and the byte was dropped
+ */
+size_t LogBuffer::write(uint8_t c)
+{
+  if(blocking)
+  {
+    while(pending() >= LOG_BUFFER_SIZE)
+      drain();
+  }
+  uint8_t sreg = SREG;
+  cli();
+  bool added = push(c);
+  SREG = sreg;
+  return added ? 1 : 0;
+}
+
+/*!
+ *  @brief  Add bytes to the log without waiting
+ *  @param  buffer the bytes
+ *  @param  size number of bytes
+ *  @return Number of bytes added
+ */
+size_t LogBuffer::write(const uint8_t *buffer, size_t size)
+{
+  size_t added = 0;
+  while(size-- > 0)
+    added += write(*buffer++);
+  return added;
+}
+
+/*!
+ *  @brief  Add a whole message to the log or nothing at all, for Interrupt Service Routines (ArduinoLog is not reentrant)
+ *  @param  text the message
+ *  @return False if the message did not fit and was dropped
+ */
+bool LogBuffer::message(const __FlashStringHelper *text)
+{
+  const char *p = (const char *)text;
+  uint16_t length = strlen_P(p);
+  uint8_t sreg = SREG;
+  cli();
+  bool fits = LOG_BUFFER_SIZE - (uint16_t)(head - tail) >= length;
+  if(fits)
+  {
+    while(length-- > 0)
+      push(pgm_read_byte(p++));
+  }
+  else
+  {
+    droppedBytes = (uint32_t)droppedBytes + length > 0xFFFF ? 0xFFFF : droppedBytes + length;
+  }
+  SREG = sreg;
+  return fits;
+}
+
+/*!
+ *  @brief  Move as much of the log to the serial port as its transmit buffer takes without waiting (the core transmits it from the
+ *          USART Data Register Empty interrupt), call on every pass of the scheduler
+ *          Each byte is taken and handed to the serial port with interrupts disabled, so the Watch Dog interrupt can drain too
+ *          without reordering the bytes or reentering the serial port
+ *          Once the backlog is gone the number of bytes dropped since the last report is logged
+ */
+void LogBuffer::drain()
+{
+  if(out == NULL)
+    return;
+  for(;;)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    if(head == tail || out->availableForWrite() <= 0)
+    {
+      SREG = sreg;
+      break;
+    }
+    out->write(buffer[tail % LOG_BUFFER_SIZE]);
+    ++tail;
+    SREG = sreg;
+  }
+
+  uint16_t drops = dropped();
+  if(drops != droppedReported && pending() == 0)
+  {
+    print(F("\n[Log dropped "));
+    print(drops - droppedReported);
+    print(F(" bytes]\n"));
+    droppedReported = drops;
+  }
+}
+
+/*!
+ *  @brief  Wait until the whole log has been sent (never call from an Interrupt Service Routine)
+ */
+void LogBuffer::flush()
+{
+  while(pending() != 0)
+    drain();
+  if(out != NULL)
+    out->flush();
+}
+
+/*!
+ *  @brief  Wait for room instead of dropping bytes, for the Serial commands that dump more than the buffer holds (never from an Interrupt Service Routine)
+ *  @param  blocking true to wait for room
+ */
+void LogBuffer::setBlocking(bool blocking)
+{
+  this->blocking = blocking;
+}
+
+/*!
+ *  @brief  Get the number of bytes waiting to be drained
+ *  @return Number of bytes
+ */
+uint16_t LogBuffer::pending()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t count = head - tail;
+  SREG = sreg;
+  return count;
+}
+
+/*!
+ *  @brief  Get the number of bytes dropped because the buffer was full
+ *  @return Number of bytes (saturates at 65535)
+ */
+uint16_t LogBuffer::dropped()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t count = droppedBytes;
+  SREG = sreg;
+  return count;
+}
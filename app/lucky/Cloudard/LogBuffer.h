@@ -0,0 +1,88 @@
+/**
+ * NAME: LogBuffer.h
+ * DESCRIPTION: Header file for the log sink that keeps the log in a RAM ring buffer so logging never waits for the serial port,
+ *              and the log macros that remove the calls (and their format strings) above the compiled log level.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef LogBuffer_h
+#define LogBuffer_h
+
+#include <Arduino.h>
+#include <ArduinoLog.h>
+
+// Size of the ring buffer (a power of 2 up to 256), bytes that do not fit are dropped and counted
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 256
+#endif
+
+// Highest log level compiled in (LOG_LEVEL_SILENT removes every log call)
+#ifndef LOG_COMPILED_LEVEL
+#define LOG_COMPILED_LEVEL LOG_LEVEL_VERBOSE
+#endif
+
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_FATAL
+  #define LOG_FATAL(...) Log.fatal(__VA_ARGS__)
+#else
+  #define LOG_FATAL(...)
+#endif
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_ERROR
+  #define LOG_ERROR(...) Log.error(__VA_ARGS__)
+#else
+  #define LOG_ERROR(...)
+#endif
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_WARNING
+  #define LOG_WARNING(...) Log.warning(__VA_ARGS__)
+#else
+  #define LOG_WARNING(...)
+#endif
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_NOTICE
+  #define LOG_NOTICE(...) Log.notice(__VA_ARGS__)
+#else
+  #define LOG_NOTICE(...)
+#endif
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_TRACE
+  #define LOG_TRACE(...) Log.trace(__VA_ARGS__)
+#else
+  #define LOG_TRACE(...)
+#endif
+#if LOG_COMPILED_LEVEL >= LOG_LEVEL_VERBOSE
+  #define LOG_VERBOSE(...) Log.verbose(__VA_ARGS__)
+#else
+  #define LOG_VERBOSE(...)
+#endif
+
+class LogBuffer : public Print
+{
+  public:
+    LogBuffer();
+    void begin(HardwareSerial &out);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    bool message(const __FlashStringHelper *text);
+    void drain();
+    void flush();
+    void setBlocking(bool blocking);
+    uint16_t pending();
+    uint16_t dropped();
+
+  private:
+    HardwareSerial *out;
+    uint8_t buffer[LOG_BUFFER_SIZE];
+    volatile uint16_t head;     // Next byte written (only changed with interrupts disabled)
+    volatile uint16_t tail;     // Next byte drained
+    volatile uint16_t droppedBytes;
+    uint16_t droppedReported;
+    bool blocking;              // Wait for room instead of dropping (for the Serial commands that dump a lot at once)
+
+    bool push(uint8_t c);
+};
+
+extern LogBuffer logBuffer;
+
+#endif
@@ -0,0 +1,184 @@
+#include "LowPower.h"
+#include "Scheduler.h"
+#include "LogBuffer.h"
+#include <WiFiNINA.h>
+#include <avr/sleep.h>
+
+static power_stats stats;
+static unsigned long wakeMicros = 0;    // micros() when the CPU last woke up (micros() stops in standby but not while awake or in IDLE)
+static uint32_t wakeTick = 0;           // Scheduler tick when the CPU last woke up
+static uint16_t awakeRemainder = 0;     // Microseconds not yet added to awakeMs and idleMs
+static uint16_t idleRemainder = 0;
+static bool ninaLowPower = false;
+
+/**
+ * NAME: addMicros()
+ * DESCRIPTION: Add a time in microseconds to a duty cycle counter in milliseconds (the remainder is kept for the next time).
+ *
+ * INPUTS:
+ *    ms          The counter
+ *    remainder   Microseconds not yet added to the counter
+ *    us          The time to add
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void addMicros(uint32_t *ms, uint16_t *remainder, unsigned long us)
+{
+  us += *remainder;
+  *ms += us / 1000;
+  *remainder = us % 1000;
+}
+
+/**
+ * NAME: powerBegin()
+ * DESCRIPTION: Start the duty cycle counters, put the NINA module in its low power mode, and enable the Serial wake up
+ *              (call after Serial, the RTC, and WiFi are started).
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void powerBegin()
+{
+  memset(&stats, 0, sizeof(stats));
+  stats.startTick = wakeTick = schedulerTicks();
+  wakeMicros = micros();
+  awakeRemainder = 0;
+  idleRemainder = 0;
+  WiFi.lowPowerMode();
+  ninaLowPower = true;
+
+  // Let the start bit of a received character wake the CPU from standby (the character is then received as usual)
+  HWSERIAL0->CTRLB |= USART_SFDEN_bm;
+}
+
+/**
+ * NAME: powerSleep()
+ * DESCRIPTION: Sleep until the next interrupt, call after every pass of the Task Scheduler.
+ * PROCESS:   Take the NINA module out of its low power mode while there is network work and put it back once it is done
+ *            Do not sleep if the scheduler ticked while the tasks ran (a periodic task may be due)
+ *            Standby if nothing needs millis() and the log has been sent, the RTC PIT, the INT of the Lucky Shield inputs, and the
+ *            start bit of a Serial command wake the CPU
+ *            Otherwise IDLE, which keeps millis(), the USART and the SPI running and wakes on every timer interrupt
+ *            Add the time awake and in IDLE to the duty cycle counters (the time in standby is the rest of the scheduler time)
+ *
+ * INPUTS:
+ *    busy    True while network timeouts, retries, or the input debounce are timed with millis()
+ * OUTPUTS:
+ *    None
+ *
+ */
+void powerSleep(bool busy)
+{
+  // The NINA module only saves power while nothing is sent or received
+  if(busy == ninaLowPower)
+  {
+    if(busy)
+      WiFi.noLowPowerMode();
+    else
+      WiFi.lowPowerMode();
+    ninaLowPower = !busy;
+  }
+
+  // An interrupt between this check and the sleep only delays the next pass until the next tick
+  uint32_t tick = schedulerTicks();
+  if(tick != wakeTick)
+  {
+    wakeTick = tick;
+    return;
+  }
+
+  // Characters still in the log or the serial buffer would stop being sent in standby
+  bool standby = !busy && logBuffer.pending() == 0 && Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1;
+  if(standby)
+    Serial.flush();
+
+  unsigned long sleepMicros = micros();
+  addMicros(&stats.awakeMs, &awakeRemainder, sleepMicros - wakeMicros);
+  SLPCTRL.CTRLA = (standby ? SLPCTRL_SMODE_STDBY_gc : SLPCTRL_SMODE_IDLE_gc) | SLPCTRL_SEN_bm;
+  sleep_cpu();
+  SLPCTRL.CTRLA &= ~SLPCTRL_SEN_bm;
+  wakeMicros = micros();
+  wakeTick = schedulerTicks();
+
+  if(standby)
+  {
+    ++stats.standbySleeps;
+  }
+  else
+  {
+    ++stats.idleSleeps;
+    addMicros(&stats.idleMs, &idleRemainder, wakeMicros - sleepMicros);
+  }
+}
+
+/**
+ * NAME: powerStats()
+ * DESCRIPTION: Get the duty cycle counters.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    The counters
+ *
+ */
+const power_stats *powerStats()
+{
+  return &stats;
+}
+
+/**
+ * NAME: elapsedSecs()
+ * DESCRIPTION: Get the scheduler time since the duty cycle counters were started.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Elapsed seconds
+ *
+ */
+static uint32_t elapsedSecs()
+{
+  return (schedulerTicks() - stats.startTick) / SCHEDULER_TICK_HZ;
+}
+
+/**
+ * NAME: powerAsleepPermille()
+ * DESCRIPTION: Get the share of the time the CPU was asleep (IDLE and standby).
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Time asleep in thousandths (0 during the first second)
+ *
+ */
+uint16_t powerAsleepPermille()
+{
+  uint32_t secs = elapsedSecs();
+  if(secs == 0)
+    return 0;
+  uint32_t awake = stats.awakeMs / secs;
+  return awake < 1000 ? 1000 - awake : 0;
+}
+
+/**
+ * NAME: powerStandbyPermille()
+ * DESCRIPTION: Get the share of the time the CPU was in standby.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Time in standby in thousandths (0 during the first second)
+ *
+ */
+uint16_t powerStandbyPermille()
+{
+  uint32_t secs = elapsedSecs();
+  if(secs == 0)
+    return 0;
+  uint32_t running = (stats.awakeMs + stats.idleMs) / secs;
+  return running < 1000 ? 1000 - running : 0;
+}
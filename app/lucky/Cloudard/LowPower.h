@@ -0,0 +1,32 @@
+/**
+ * NAME: LowPower.h
+ * DESCRIPTION: Header file for the low power sleep between the passes of the Task Scheduler (the RTC PIT wakes the CPU on every tick)
+ *              and the duty cycle counters that show how long the CPU was asleep.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef LowPower_h
+#define LowPower_h
+
+#include <Arduino.h>
+
+typedef struct
+{
+  uint32_t startTick;       // Scheduler tick the counters were started at
+  uint32_t awakeMs;         // Time the CPU was running
+  uint32_t idleMs;          // Time in IDLE sleep (timers and the NINA SPI keep running while network work is pending)
+  uint32_t idleSleeps;
+  uint32_t standbySleeps;
+} power_stats;
+
+extern void powerBegin();
+extern void powerSleep(bool busy);
+extern const power_stats *powerStats();
+extern uint16_t powerAsleepPermille();
+extern uint16_t powerStandbyPermille();
+
+#endif
@@ -0,0 +1,470 @@
+#include "Metrics.h"
+
+#if METRICS
+#include "Scheduler.h"
+#include "Dispatcher.h"
+#include "LogBuffer.h"
+#include <avr/interrupt.h>
+
+// Histogram summary attached to uploads (milliseconds saturated at 65535)
+typedef struct
+{
+  uint16_t count;
+  uint16_t p50Ms;
+  uint16_t p90Ms;
+  uint16_t maxMs;
+} metrics_summary;
+
+static volatile uint16_t timerOverflows = 0;
+static uint32_t startTick = 0;
+static metrics_histogram histograms[METRIC_COUNT];
+static metrics_endpoint endpoints[ENDPOINT_SLOTS];
+
+// Snapshot attached to uploads (the dispatcher writes the body several times so it must not change while the POSTs run)
+static uint32_t snapshotSecs = 0;
+static metrics_summary snapshotHistograms[METRIC_COUNT];
+static metrics_endpoint snapshotEndpoints[ENDPOINT_SLOTS];
+
+static const char readName[] PROGMEM = "read";
+static const char encodeName[] PROGMEM = "encode";
+static const char displayName[] PROGMEM = "display";
+static const char *const phaseNames[] PROGMEM = { readName, encodeName, displayName };
+
+/**
+ * NAME: ISR()
+ * DESCRIPTION: Interrupt Service Routine for the probe timer, extends the 16 bit count to 32 bits.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+ISR(METRICS_TIMER_VECTOR)
+{
+  METRICS_TIMER.INTFLAGS = TCB_CAPT_bm;
+  ++timerOverflows;
+}
+
+/**
+ * NAME: bucketOf()
+ * DESCRIPTION: Get the histogram bucket of a duration.
+ *
+ * INPUTS:
+ *    us    The duration in microseconds
+ * OUTPUTS:
+ *    The bucket (0 under 1 ms, else 1 + log2 of the milliseconds up to METRICS_BUCKETS - 1)
+ *
+ */
+static uint8_t bucketOf(uint32_t us)
+{
+  uint32_t ms = us / 1000;
+  uint8_t bucket = 0;
+  while(ms != 0 && bucket < METRICS_BUCKETS - 1)
+  {
+    ms >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+/**
+ * NAME: bucketLimitMs()
+ * DESCRIPTION: Get the upper limit of a histogram bucket.
+ *
+ * INPUTS:
+ *    bucket    The bucket
+ * OUTPUTS:
+ *    The limit in milliseconds
+ *
+ */
+static uint32_t bucketLimitMs(uint8_t bucket)
+{
+  return 1UL << bucket;
+}
+
+/**
+ * NAME: percentileMs()
+ * DESCRIPTION: Estimate a percentile of a histogram from its buckets.
+ *
+ * INPUTS:
+ *    histogram   The histogram
+ *    percent     The percentile
+ * OUTPUTS:
+ *    Upper limit of the bucket the percentile falls in (never more than the maximum) in milliseconds
+ *
+ */
+static uint32_t percentileMs(const metrics_histogram *histogram, uint8_t percent)
+{
+  uint32_t maxMs = (histogram->maxUs + 999) / 1000;
+  uint32_t target = ((uint32_t)histogram->count * percent + 99) / 100;
+  uint32_t total = 0;
+  for(uint8_t bucket = 0;bucket < METRICS_BUCKETS;++bucket)
+  {
+    total += histogram->buckets[bucket];
+    if(total >= target)
+      return min(bucketLimitMs(bucket), maxMs);
+  }
+  return maxMs;
+}
+
+/**
+ * NAME: saturate()
+ * DESCRIPTION: Limit a value to 16 bits.
+ *
+ * INPUTS:
+ *    value   The value
+ * OUTPUTS:
+ *    The value or 65535
+ *
+ */
+static uint16_t saturate(uint32_t value)
+{
+  return value > 0xFFFF ? 0xFFFF : value;
+}
+
+/**
+ * NAME: metricsBegin()
+ * DESCRIPTION: Start the probe timer and clear the metrics.
+ * PROCESS:   Run the TCB in periodic interrupt mode over its full 16 bit range from the TCA0 clock
+ *            The overflow interrupt only fires every 262 ms and the TCB stops in standby (nothing is timed while asleep)
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsBegin()
+{
+  METRICS_TIMER.CTRLA = 0;
+  METRICS_TIMER.CTRLB = TCB_CNTMODE_INT_gc;
+  METRICS_TIMER.CCMP = 0xFFFF;
+  METRICS_TIMER.CNT = 0;
+  METRICS_TIMER.INTFLAGS = TCB_CAPT_bm;
+  METRICS_TIMER.INTCTRL = TCB_CAPT_bm;
+  METRICS_TIMER.CTRLA = TCB_CLKSEL_CLKTCA_gc | TCB_ENABLE_bm;
+  metricsReset();
+}
+
+/**
+ * NAME: metricsReset()
+ * DESCRIPTION: Clear the histograms and counters.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsReset()
+{
+  memset(histograms, 0, sizeof(histograms));
+  memset(endpoints, 0, sizeof(endpoints));
+  startTick = schedulerTicks();
+}
+
+/**
+ * NAME: metricsNow()
+ * DESCRIPTION: Read the probe timer (safe with interrupts disabled, a pending overflow is counted).
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Timer counts, METRICS_US_PER_COUNT microseconds each (wraps after 4.7 hours)
+ *
+ */
+uint32_t metricsNow()
+{
+  uint8_t sreg = SREG;
+  cli();
+  uint16_t count = METRICS_TIMER.CNT;
+  uint16_t overflows = timerOverflows;
+  if((METRICS_TIMER.INTFLAGS & TCB_CAPT_bm) && count < 0x8000)
+    ++overflows;
+  SREG = sreg;
+  return ((uint32_t)overflows << 16) | count;
+}
+
+/**
+ * NAME: metricsRecord()
+ * DESCRIPTION: Add the time since a probe was started to a histogram.
+ *
+ * INPUTS:
+ *    metric    The metric (METRIC_READ, METRIC_CONNECT(slot), ...)
+ *    start     metricsNow() when the phase started
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsRecord(uint8_t metric, uint32_t start)
+{
+  if(metric >= METRIC_COUNT)
+    return;
+  uint32_t us = (metricsNow() - start) * METRICS_US_PER_COUNT;
+  metrics_histogram *histogram = &histograms[metric];
+  uint8_t bucket = bucketOf(us);
+  if(histogram->buckets[bucket] != 0xFFFF)
+    ++histogram->buckets[bucket];
+  if(histogram->count != 0xFFFF)
+    ++histogram->count;
+  if(us > histogram->maxUs)
+    histogram->maxUs = us;
+}
+
+/**
+ * NAME: metricsStatus()
+ * DESCRIPTION: Count the result of a POST to a REST endpoint.
+ *
+ * INPUTS:
+ *    slot      The REST endpoint slot
+ *    status    HTTP Status Code or Dispatch error code
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsStatus(uint8_t slot, int status)
+{
+  if(slot >= ENDPOINT_SLOTS || status == DISPATCH_SKIPPED)
+    return;
+  metrics_endpoint *counters = &endpoints[slot];
+  uint16_t *counter;
+  if(status >= 200 && status <= 299)
+    counter = &counters->success;
+  else if(status >= 300 && status <= 399)
+    counter = &counters->redirect;
+  else if(status >= 400 && status <= 499)
+    counter = &counters->clientError;
+  else if(status >= 500 && status <= 599)
+    counter = &counters->serverError;
+  else if(status == DISPATCH_ERROR_TIMEOUT)
+    counter = &counters->timeouts;
+  else
+    counter = &counters->errors;
+  if(*counter != 0xFFFF)
+    ++*counter;
+}
+
+/**
+ * NAME: metricsHistogram()
+ * DESCRIPTION: Get a histogram.
+ *
+ * INPUTS:
+ *    metric    The metric
+ * OUTPUTS:
+ *    The histogram (NULL for an unknown metric)
+ *
+ */
+const metrics_histogram *metricsHistogram(uint8_t metric)
+{
+  return metric < METRIC_COUNT ? &histograms[metric] : NULL;
+}
+
+/**
+ * NAME: metricsEndpoint()
+ * DESCRIPTION: Get the counters of a REST endpoint.
+ *
+ * INPUTS:
+ *    slot    The REST endpoint slot
+ * OUTPUTS:
+ *    The counters (NULL for an unknown slot)
+ *
+ */
+const metrics_endpoint *metricsEndpoint(uint8_t slot)
+{
+  return slot < ENDPOINT_SLOTS ? &endpoints[slot] : NULL;
+}
+
+/**
+ * NAME: dumpHistogram()
+ * DESCRIPTION: Log a histogram with its non empty buckets.
+ *
+ * INPUTS:
+ *    name        Name of the phase
+ *    host        REST endpoint host (NULL for the other phases)
+ *    histogram   The histogram
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void dumpHistogram(const __FlashStringHelper *name, const char *host, const metrics_histogram *histogram)
+{
+  if(histogram->count == 0)
+    return;
+  LOG_NOTICE(F("  %S%s%s: %d, p50 %l ms, p90 %l ms, max %l us, buckets (up to ms:count)"), name, host != NULL ? " " : "", host != NULL ? host : "",
+    histogram->count, percentileMs(histogram, 50), percentileMs(histogram, 90), histogram->maxUs);
+  for(uint8_t bucket = 0;bucket < METRICS_BUCKETS;++bucket)
+  {
+    if(histogram->buckets[bucket] != 0)
+      LOG_NOTICE(bucket < METRICS_BUCKETS - 1 ? F(" %l:%d") : F(" more:%d"), bucketLimitMs(bucket), histogram->buckets[bucket]);
+  }
+  LOG_NOTICE(F("\n"));
+}
+
+/**
+ * NAME: metricsDump()
+ * DESCRIPTION: Log every histogram and the counters of the REST endpoints that have been used.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsDump()
+{
+  LOG_NOTICE(F("Metrics over the last %l secs:\n"), (schedulerTicks() - startTick) / SCHEDULER_TICK_HZ);
+  for(uint8_t metric = 0;metric < METRIC_CONNECT(0);++metric)
+    dumpHistogram((const __FlashStringHelper *)pgm_read_ptr(&phaseNames[metric]), NULL, &histograms[metric]);
+  for(uint8_t slot = 0;slot < ENDPOINT_SLOTS;++slot)
+  {
+    const endpoint *ep = endpointGet(slot);
+    const metrics_endpoint *counters = &endpoints[slot];
+    if(ep == NULL || histograms[METRIC_REQUEST(slot)].count == 0)
+      continue;
+    LOG_NOTICE(F("  %s: %d 2xx, %d 3xx, %d 4xx, %d 5xx, %d timeouts, %d errors\n"), ep->host, counters->success, counters->redirect,
+      counters->clientError, counters->serverError, counters->timeouts, counters->errors);
+    dumpHistogram(F("connect"), ep->host, &histograms[METRIC_CONNECT(slot)]);
+    dumpHistogram(F("request"), ep->host, &histograms[METRIC_REQUEST(slot)]);
+  }
+}
+
+/**
+ * NAME: metricsSnapshot()
+ * DESCRIPTION: Take the summary of the metrics written by metricsWriteJSON() and metricsWriteCBOR().
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsSnapshot()
+{
+  snapshotSecs = (schedulerTicks() - startTick) / SCHEDULER_TICK_HZ;
+  for(uint8_t metric = 0;metric < METRIC_COUNT;++metric)
+  {
+    const metrics_histogram *histogram = &histograms[metric];
+    metrics_summary *summary = &snapshotHistograms[metric];
+    summary->count = histogram->count;
+    summary->p50Ms = saturate(percentileMs(histogram, 50));
+    summary->p90Ms = saturate(percentileMs(histogram, 90));
+    summary->maxMs = saturate((histogram->maxUs + 999) / 1000);
+  }
+  memcpy(snapshotEndpoints, endpoints, sizeof(snapshotEndpoints));
+}
+
+/**
+ * NAME: writeSummaryJSON()
+ * DESCRIPTION: Write a histogram summary as a JSON array [count, p50, p90, max] in milliseconds.
+ *
+ * INPUTS:
+ *    json      The JSON writer
+ *    name      Member name
+ *    summary   The summary
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void writeSummaryJSON(JsonWriter &json, const __FlashStringHelper *name, const metrics_summary *summary)
+{
+  json.beginArray(name);
+  json.value(summary->count);
+  json.value(summary->p50Ms);
+  json.value(summary->p90Ms);
+  json.value(summary->maxMs);
+  json.endArray();
+}
+
+/**
+ * NAME: metricsWriteJSON()
+ * DESCRIPTION: Write the snapshot as a "metrics" member of the current JSON object:
+ *              {"secs":s,"read":[...],"encode":[...],"display":[...],"endpoints":[{"success":n,...,"connect":[...],"request":[...]},...]}
+ *              Every histogram is [count, p50, p90, max] in milliseconds and the endpoints are in slot order.
+ *
+ * INPUTS:
+ *    json    The JSON writer
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsWriteJSON(JsonWriter &json)
+{
+  json.beginObject(F("metrics"));
+  json.field(F("secs"), snapshotSecs);
+  writeSummaryJSON(json, F("read"), &snapshotHistograms[METRIC_READ]);
+  writeSummaryJSON(json, F("encode"), &snapshotHistograms[METRIC_ENCODE]);
+  writeSummaryJSON(json, F("display"), &snapshotHistograms[METRIC_DISPLAY]);
+  json.beginArray(F("endpoints"));
+  for(uint8_t slot = 0;slot < ENDPOINT_SLOTS;++slot)
+  {
+    const metrics_endpoint *counters = &snapshotEndpoints[slot];
+    json.beginObject();
+    json.field(F("success"), counters->success);
+    json.field(F("redirect"), counters->redirect);
+    json.field(F("clientError"), counters->clientError);
+    json.field(F("serverError"), counters->serverError);
+    json.field(F("timeouts"), counters->timeouts);
+    json.field(F("errors"), counters->errors);
+    writeSummaryJSON(json, F("connect"), &snapshotHistograms[METRIC_CONNECT(slot)]);
+    writeSummaryJSON(json, F("request"), &snapshotHistograms[METRIC_REQUEST(slot)]);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+/**
+ * NAME: writeSummaryCBOR()
+ * DESCRIPTION: Write a histogram summary as a CBOR array [count, p50, p90, max] in milliseconds.
+ *
+ * INPUTS:
+ *    cbor      The CBOR writer
+ *    summary   The summary
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void writeSummaryCBOR(CborWriter &cbor, const metrics_summary *summary)
+{
+  cbor.array(4);
+  cbor.integer(summary->count);
+  cbor.integer(summary->p50Ms);
+  cbor.integer(summary->p90Ms);
+  cbor.integer(summary->maxMs);
+}
+
+/**
+ * NAME: metricsWriteCBOR()
+ * DESCRIPTION: Write the snapshot as a CBOR array with the same content as the JSON:
+ *              [ secs, read, encode, display, [ [success, redirect, clientError, serverError, timeouts, errors, connect, request], ... ] ]
+ *
+ * INPUTS:
+ *    cbor    The CBOR writer
+ * OUTPUTS:
+ *    None
+ *
+ */
+void metricsWriteCBOR(CborWriter &cbor)
+{
+  cbor.array(5);
+  cbor.integer(snapshotSecs);
+  writeSummaryCBOR(cbor, &snapshotHistograms[METRIC_READ]);
+  writeSummaryCBOR(cbor, &snapshotHistograms[METRIC_ENCODE]);
+  writeSummaryCBOR(cbor, &snapshotHistograms[METRIC_DISPLAY]);
+  cbor.array(ENDPOINT_SLOTS);
+  for(uint8_t slot = 0;slot < ENDPOINT_SLOTS;++slot)
+  {
+    const metrics_endpoint *counters = &snapshotEndpoints[slot];
+    cbor.array(8);
+    cbor.integer(counters->success);
+    cbor.integer(counters->redirect);
+    cbor.integer(counters->clientError);
+    cbor.integer(counters->serverError);
+    cbor.integer(counters->timeouts);
+    cbor.integer(counters->errors);
+    writeSummaryCBOR(cbor, &snapshotHistograms[METRIC_CONNECT(slot)]);
+    writeSummaryCBOR(cbor, &snapshotHistograms[METRIC_REQUEST(slot)]);
+  }
+}
+#endif
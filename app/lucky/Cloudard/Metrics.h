@@ -0,0 +1,82 @@
+/**
+ * NAME: Metrics.h
+ * DESCRIPTION: Header file for the timing probes and counters that show which phase of the cycle (and which REST endpoint) takes the time.
+ *              The probes count a TCB clocked from TCA0 (4 us resolution) extended to 32 bits in software, the durations go into log2
+ *              histograms kept in a static block of RAM.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef Metrics_h
+#define Metrics_h
+
+#include <Arduino.h>
+#include "Endpoints.h"
+#include "JsonWriter.h"
+#include "CborWriter.h"
+
+// Set this to 0 to remove the timing probes and counters
+#ifndef METRICS
+#define METRICS 1
+#endif
+
+// Timer used by the probes (TCB0 and TCB1 drive PWM pins and TCB3 drives millis() in the core) and its resolution
+// (TCA0 runs at F_CPU / 64 in the core)
+#define METRICS_TIMER TCB2
+#define METRICS_TIMER_VECTOR TCB2_INT_vect
+#define METRICS_US_PER_COUNT (64000000UL / F_CPU)
+
+// Histogram buckets: bucket 0 is under 1 ms and bucket b is 2^(b-1) ms up to 2^b ms (the last bucket has everything from 16.384 s)
+#define METRICS_BUCKETS 16
+
+// Metrics
+#define METRIC_READ               0                                   // Sensor read
+#define METRIC_ENCODE             1                                   // Measuring the POST body in every payload format
+#define METRIC_DISPLAY            2                                   // Remote LED Display command sent until acknowledged
+#define METRIC_CONNECT(slot)      (3 + (slot))                        // DNS lookup and connect of a REST endpoint (new connections only)
+#define METRIC_REQUEST(slot)      (3 + ENDPOINT_SLOTS + (slot))       // Whole POST to a REST endpoint until its status or error
+#define METRIC_COUNT              (3 + 2 * ENDPOINT_SLOTS)
+
+typedef struct
+{
+  uint16_t buckets[METRICS_BUCKETS];    // Counts saturate at 65535
+  uint16_t count;
+  uint32_t maxUs;
+} metrics_histogram;
+
+typedef struct
+{
+  uint16_t success;         // 2xx
+  uint16_t redirect;        // 3xx
+  uint16_t clientError;     // 4xx
+  uint16_t serverError;     // 5xx
+  uint16_t timeouts;
+  uint16_t errors;          // DNS, socket, connect, and send errors and unexpected status codes
+} metrics_endpoint;
+
+#if METRICS
+  #define METRICS_START() metricsNow()
+  #define METRICS_RECORD(metric, start) metricsRecord((metric), (start))
+  #define METRICS_STATUS(slot, status) metricsStatus((slot), (status))
+#else
+  #define METRICS_START() 0
+  #define METRICS_RECORD(metric, start)
+  #define METRICS_STATUS(slot, status)
+#endif
+
+extern void metricsBegin();
+extern void metricsReset();
+extern uint32_t metricsNow();
+extern void metricsRecord(uint8_t metric, uint32_t start);
+extern void metricsStatus(uint8_t slot, int status);
+extern const metrics_histogram *metricsHistogram(uint8_t metric);
+extern const metrics_endpoint *metricsEndpoint(uint8_t slot);
+extern void metricsDump();
+extern void metricsSnapshot();
+extern void metricsWriteJSON(JsonWriter &json);
+extern void metricsWriteCBOR(CborWriter &cbor);
+
+#endif
@@ -0,0 +1,207 @@
+#include "PostQueue.h"
+#include <EEPROM.h>
+
+#define TAG_SEQUENCE(tag)   ((tag) >> 4)
+#define TAG_PENDING(tag)    ((tag) & 0x0F)
+#define TIMESTAMP_ERASED    0xFFFFFFFFUL
+
+static_assert(sizeof(queued_sample) + 1 == QUEUE_RECORD_SIZE, "Queue record does not match QUEUE_RECORD_SIZE");
+
+static uint8_t writeSlot = 0;         // Slot the next record is written to (the oldest record once the ring is full)
+static uint8_t nextSequence = 0;
+static uint16_t dropped = 0;
+
+/**
+ * NAME: slotAddress()
+ * DESCRIPTION: Get the EEPROM address of a record slot.
+ * 
+ * INPUTS:
+ *    slot    The slot
+ * OUTPUTS:
+ *    EEPROM address
+ *    
+ */
+static int slotAddress(uint8_t slot)
+{
+  return EEPROM_QUEUE_ADDRESS + slot * QUEUE_RECORD_SIZE;
+}
+
+/**
+ * NAME: readTag()
+ * DESCRIPTION: Read the tag of a record slot.
+ * 
+ * INPUTS:
+ *    slot    The slot
+ *    tag     Returned tag
+ * OUTPUTS:
+ *    True if the slot has ever been written
+ *    
+ */
+static bool readTag(uint8_t slot, uint8_t *tag)
+{
+  uint32_t timestamp;
+  EEPROM.get(slotAddress(slot) + 1, timestamp);
+  *tag = EEPROM.read(slotAddress(slot));
+  return timestamp != TIMESTAMP_ERASED;
+}
+
+/**
+ * NAME: postQueueBegin()
+ * DESCRIPTION: Find the newest record so the queue continues where it left off before a reset.
+ * PROCESS:   Records are written round robin so every slot wears at the same rate
+ *            The newest record is the one whose successor breaks the sequence numbering
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void postQueueBegin()
+{
+  writeSlot = 0;
+  nextSequence = 0;
+  for(uint8_t slot = 0;slot < QUEUE_RECORDS;++slot)
+  {
+    uint8_t tag, nextTag;
+    uint8_t next = (slot + 1) % QUEUE_RECORDS;
+    if(!readTag(slot, &tag))
+      continue;
+    if(!readTag(next, &nextTag) || TAG_SEQUENCE(nextTag) != ((TAG_SEQUENCE(tag) + 1) & 0x0F))
+    {
+      writeSlot = next;
+      nextSequence = (TAG_SEQUENCE(tag) + 1) & 0x0F;
+      break;
+    }
+  }
+}
+
+/**
+ * NAME: postQueueAdd()
+ * DESCRIPTION: Store a sample that could not be delivered to some of the REST Endpoints.
+ * PROCESS:   When the queue is full the oldest record is overwritten (and counted as dropped if it was still pending)
+ * 
+ * INPUTS:
+ *    sample    The sample
+ *    pending   Bit mask of the REST Endpoints the sample still has to be delivered to
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void postQueueAdd(const queued_sample *sample, uint8_t pending)
+{
+  uint8_t tag;
+  if(readTag(writeSlot, &tag) && TAG_PENDING(tag) != 0)
+    ++dropped;
+
+  // EEPROM.put() only writes the bytes that changed
+  int address = slotAddress(writeSlot);
+  EEPROM.put(address + 1, *sample);
+  EEPROM.update(address, (nextSequence << 4) | (pending & 0x0F));
+  writeSlot = (writeSlot + 1) % QUEUE_RECORDS;
+  nextSequence = (nextSequence + 1) & 0x0F;
+}
+
+/**
+ * NAME: postQueueNext()
+ * DESCRIPTION: Get the oldest record that still has to be delivered.
+ * 
+ * INPUTS:
+ *    sample    Returned sample
+ *    pending   Returned bit mask of the REST Endpoints the sample still has to be delivered to
+ * OUTPUTS:
+ *    Slot of the record or -1 if the queue is empty
+ *    
+ */
+int postQueueNext(queued_sample *sample, uint8_t *pending)
+{
+  for(uint8_t i = 0;i < QUEUE_RECORDS;++i)
+  {
+    uint8_t tag;
+    uint8_t slot = (writeSlot + i) % QUEUE_RECORDS;
+    if(!readTag(slot, &tag) || TAG_PENDING(tag) == 0)
+      continue;
+    EEPROM.get(slotAddress(slot) + 1, *sample);
+    *pending = TAG_PENDING(tag);
+    return slot;
+  }
+  return -1;
+}
+
+/**
+ * NAME: postQueueDelivered()
+ * DESCRIPTION: Mark a record as delivered to some of the REST Endpoints, once it is delivered to all of them the slot is free.
+ * 
+ * INPUTS:
+ *    slot        Slot returned by postQueueNext()
+ *    delivered   Bit mask of the REST Endpoints the sample was delivered to
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void postQueueDelivered(int slot, uint8_t delivered)
+{
+  uint8_t tag;
+  if(slot < 0 || slot >= QUEUE_RECORDS || !readTag(slot, &tag))
+    return;
+  EEPROM.update(slotAddress(slot), tag & ~(delivered & 0x0F));
+}
+
+/**
+ * NAME: postQueueCount()
+ * DESCRIPTION: Get the number of records that still have to be delivered to at least one REST Endpoint.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Number of records
+ *    
+ */
+uint8_t postQueueCount()
+{
+  uint8_t count = 0;
+  for(uint8_t slot = 0;slot < QUEUE_RECORDS;++slot)
+  {
+    uint8_t tag;
+    if(readTag(slot, &tag) && TAG_PENDING(tag) != 0)
+      ++count;
+  }
+  return count;
+}
+
+/**
+ * NAME: postQueuePending()
+ * DESCRIPTION: Get the delivery backlog of a single REST Endpoint.
+ * 
+ * INPUTS:
+ *    endpoint  Index of the REST Endpoint
+ * OUTPUTS:
+ *    Number of records that still have to be delivered to the REST Endpoint
+ *    
+ */
+uint8_t postQueuePending(uint8_t endpoint)
+{
+  uint8_t count = 0;
+  for(uint8_t slot = 0;slot < QUEUE_RECORDS;++slot)
+  {
+    uint8_t tag;
+    if(readTag(slot, &tag) && (TAG_PENDING(tag) & (1 << endpoint)))
+      ++count;
+  }
+  return count;
+}
+
+/**
+ * NAME: postQueueDropped()
+ * DESCRIPTION: Get the number of undelivered records that were overwritten because the queue was full.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Number of dropped records
+ *    
+ */
+uint16_t postQueueDropped()
+{
+  return dropped;
+}
@@ -0,0 +1,40 @@
+/**
+ * NAME: PostQueue.h
+ * DESCRIPTION: Header file for the store-and-forward queue that keeps the samples that could not be POSTed in EEPROM.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef PostQueue_h
+#define PostQueue_h
+
+#include <Arduino.h>
+#include "EepromLayout.h"
+
+// Each record is a tag byte (4 bit sequence number, 4 bit mask of the endpoints still to deliver to) and the sample
+#define QUEUE_RECORD_SIZE   11
+#define QUEUE_RECORDS       (EEPROM_QUEUE_SIZE / QUEUE_RECORD_SIZE)
+
+// Maximum number of REST Endpoints a record can track
+#define QUEUE_MAX_ENDPOINTS 4
+
+typedef struct
+{
+  uint32_t timestamp;     // Epoch seconds when the sample was taken (0 if the time was not known)
+  int16_t temperature;    // Hundredths of a degree F
+  uint16_t pressure;      // Hundredths of an inHg
+  uint16_t humidity;      // Hundredths of a %
+} queued_sample;
+
+extern void postQueueBegin();
+extern void postQueueAdd(const queued_sample *sample, uint8_t pending);
+extern int postQueueNext(queued_sample *sample, uint8_t *pending);
+extern void postQueueDelivered(int slot, uint8_t delivered);
+extern uint8_t postQueueCount();
+extern uint8_t postQueuePending(uint8_t endpoint);
+extern uint16_t postQueueDropped();
+
+#endif
@@ -0,0 +1,115 @@
+#include "ReportPolicy.h"
+#include "Scheduler.h"
+
+static bool reported = false;
+static weather_sample lastReported;
+static weather_sample lastSample;
+static uint16_t fastInterval = 60;
+static uint16_t interval = 60;
+static report_counts counts = { 0, 0, 0 };
+
+/**
+ * NAME: outsideDeadband()
+ * DESCRIPTION: Check if any value of a sample differs from a reference sample by more than its deadband.
+ *
+ * INPUTS:
+ *    sample      The sample
+ *    reference   The sample to compare with
+ *    divider     Divider of the deadbands (2 checks half the deadbands)
+ * OUTPUTS:
+ *    True if a value is outside its deadband
+ *
+ */
+static bool outsideDeadband(const weather_sample *sample, const weather_sample *reference, uint8_t divider)
+{
+  return abs(sample->temperature - reference->temperature) * divider > REPORT_DEADBAND_TEMPERATURE ||
+         abs((int16_t)(sample->pressure - reference->pressure)) * divider > REPORT_DEADBAND_PRESSURE ||
+         abs((int16_t)(sample->humidity - reference->humidity)) * divider > REPORT_DEADBAND_HUMIDITY;
+}
+
+/**
+ * NAME: reportBegin()
+ * DESCRIPTION: Start the reporting policy (the next sample is always reported).
+ *
+ * INPUTS:
+ *    fastSecs    Sample interval while the sensor data is changing
+ * OUTPUTS:
+ *    None
+ *
+ */
+void reportBegin(uint16_t fastSecs)
+{
+  fastInterval = fastSecs;
+  interval = fastSecs;
+  reported = false;
+}
+
+/**
+ * NAME: reportCheck()
+ * DESCRIPTION: Decide if a sample has to be reported and adapt the sample interval.
+ * PROCESS:   Report the first sample, a sample with a value outside its deadband around the last reported value, or a sample taken
+ *            REPORT_HEARTBEAT_SECS after the last report
+ *            Go back to the fast interval when a value moved by more than half its deadband since the previous sample else double the interval
+ *
+ * INPUTS:
+ *    sample    The sample
+ * OUTPUTS:
+ *    True if the sample has to be POSTed
+ *
+ */
+bool reportCheck(const weather_sample *sample)
+{
+  // Adapt the sample interval to the rate of change
+  if(!reported || outsideDeadband(sample, &lastSample, 2))
+    interval = fastInterval;
+  else
+    interval = min(interval * 2, fastInterval * REPORT_SLOW_FACTOR);
+  lastSample = *sample;
+
+  // Report significant changes and heartbeats
+  bool report = true;
+  if(!reported || outsideDeadband(sample, &lastReported, 1))
+    ++counts.changed;
+  else if(sample->ticks - lastReported.ticks >= SECONDS_TO_TICKS(REPORT_HEARTBEAT_SECS))
+    ++counts.heartbeats;
+  else
+    report = false;
+  if(!report)
+  {
+    ++counts.suppressed;
+    return false;
+  }
+  lastReported = *sample;
+  reported = true;
+  return true;
+}
+
+/**
+ * NAME: reportIntervalSecs()
+ * DESCRIPTION: Get the number of seconds until the next sample should be taken.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Sample interval in seconds
+ *
+ */
+uint16_t reportIntervalSecs()
+{
+  return interval;
+}
+
+/**
+ * NAME: reportCounts()
+ * DESCRIPTION: Get the number of samples reported and suppressed since startup.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    The counters
+ *
+ */
+const report_counts *reportCounts()
+{
+  return &counts;
+}
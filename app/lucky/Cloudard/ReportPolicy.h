@@ -0,0 +1,43 @@
+/**
+ * NAME: ReportPolicy.h
+ * DESCRIPTION: Header file for the reporting policy that only lets a sample through to the REST endpoints when it changed
+ *              significantly or a heartbeat is due, and adapts the sample interval to how fast the sensor data changes.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef ReportPolicy_h
+#define ReportPolicy_h
+
+#include <Arduino.h>
+#include "SampleBuffer.h"
+
+// Change from the last reported value (in hundredths) that is reported right away: 0.2 F, 0.01 inHg, 0.5 %
+#define REPORT_DEADBAND_TEMPERATURE 20
+#define REPORT_DEADBAND_PRESSURE    1
+#define REPORT_DEADBAND_HUMIDITY    50
+
+// Longest time without a report (a sample is reported even if nothing changed)
+#ifndef REPORT_HEARTBEAT_SECS
+#define REPORT_HEARTBEAT_SECS 1800
+#endif
+
+// The sample interval is doubled after every sample that did not move by half a deadband, up to this many times the interval used while the sensor data is changing
+#define REPORT_SLOW_FACTOR 8
+
+typedef struct
+{
+  uint16_t changed;       // Samples reported because a value moved out of its deadband (the first sample counts as changed)
+  uint16_t heartbeats;    // Samples reported because REPORT_HEARTBEAT_SECS passed
+  uint16_t suppressed;    // Samples that were not reported
+} report_counts;
+
+extern void reportBegin(uint16_t fastSecs);
+extern bool reportCheck(const weather_sample *sample);
+extern uint16_t reportIntervalSecs();
+extern const report_counts *reportCounts();
+
+#endif
@@ -0,0 +1,109 @@
+#include "SampleBuffer.h"
+
+static weather_sample samples[SAMPLE_BUFFER_SIZE];
+static uint8_t head = 0;
+static uint8_t count = 0;
+static uint16_t dropped = 0;
+
+/**
+ * NAME: sampleBufferAdd()
+ * DESCRIPTION: Add a sample to the buffer, when the buffer is full the oldest sample is dropped.
+ * 
+ * INPUTS:
+ *    sample  The sample
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void sampleBufferAdd(const weather_sample *sample)
+{
+  if(count == SAMPLE_BUFFER_SIZE)
+  {
+    sampleBufferRemove(1);
+    ++dropped;
+  }
+  samples[(head + count) & (SAMPLE_BUFFER_SIZE - 1)] = *sample;
+  ++count;
+}
+
+/**
+ * NAME: sampleBufferCount()
+ * DESCRIPTION: Get the number of samples in the buffer.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Number of samples
+ *    
+ */
+uint8_t sampleBufferCount()
+{
+  return count;
+}
+
+/**
+ * NAME: sampleBufferPeek()
+ * DESCRIPTION: Get a sample without removing it.
+ * 
+ * INPUTS:
+ *    index   Index of the sample (0 is the oldest)
+ * OUTPUTS:
+ *    The sample or NULL if there is no such sample
+ *    
+ */
+const weather_sample *sampleBufferPeek(uint8_t index)
+{
+  if(index >= count)
+    return NULL;
+  return &samples[(head + index) & (SAMPLE_BUFFER_SIZE - 1)];
+}
+
+/**
+ * NAME: sampleBufferRemove()
+ * DESCRIPTION: Remove the oldest samples.
+ * 
+ * INPUTS:
+ *    n   Number of samples to remove
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void sampleBufferRemove(uint8_t n)
+{
+  if(n > count)
+    n = count;
+  head = (head + n) & (SAMPLE_BUFFER_SIZE - 1);
+  count -= n;
+}
+
+/**
+ * NAME: sampleBufferRemoveThrough()
+ * DESCRIPTION: Remove the oldest samples up to and including the one taken at a scheduler tick.
+ *              Samples dropped by sampleBufferAdd() since the tick was read are not counted twice.
+ * 
+ * INPUTS:
+ *    ticks   Scheduler tick of the newest sample to remove
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void sampleBufferRemoveThrough(uint32_t ticks)
+{
+  while(count != 0 && (int32_t)(samples[head].ticks - ticks) <= 0)
+    sampleBufferRemove(1);
+}
+
+/**
+ * NAME: sampleBufferDropped()
+ * DESCRIPTION: Get the number of samples dropped because the buffer was full.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Number of dropped samples
+ *    
+ */
+uint16_t sampleBufferDropped()
+{
+  return dropped;
+}
@@ -0,0 +1,34 @@
+/**
+ * NAME: SampleBuffer.h
+ * DESCRIPTION: Header file for the fixed size ring buffer of sensor samples waiting to be uploaded.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef SampleBuffer_h
+#define SampleBuffer_h
+
+#include <Arduino.h>
+
+// Number of samples the buffer can hold (must be a power of 2)
+#define SAMPLE_BUFFER_SIZE 16
+
+typedef struct
+{
+  uint32_t ticks;         // Scheduler tick when the sample was taken
+  int16_t temperature;    // Hundredths of a degree F
+  uint16_t pressure;      // Hundredths of an inHg
+  uint16_t humidity;      // Hundredths of a %
+} weather_sample;
+
+extern void sampleBufferAdd(const weather_sample *sample);
+extern uint8_t sampleBufferCount();
+extern const weather_sample *sampleBufferPeek(uint8_t index);
+extern void sampleBufferRemove(uint8_t count);
+extern void sampleBufferRemoveThrough(uint32_t ticks);
+extern uint16_t sampleBufferDropped();
+
+#endif
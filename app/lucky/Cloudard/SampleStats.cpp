@@ -0,0 +1,111 @@
+#include "SampleStats.h"
+
+/**
+ * NAME: statsBegin()
+ * DESCRIPTION: Initialize the statistics of a metric (clears the median filter and starts the first window).
+ *
+ * INPUTS:
+ *    stats   The metric statistics
+ * OUTPUTS:
+ *    None
+ *
+ */
+void statsBegin(sample_stats *stats)
+{
+  stats->recentCount = 0;
+  stats->recentNext = 0;
+  statsReset(stats);
+}
+
+/**
+ * NAME: statsReset()
+ * DESCRIPTION: Start a new window (the median filter keeps the latest reads so the first read of the window is filtered too).
+ *
+ * INPUTS:
+ *    stats   The metric statistics
+ * OUTPUTS:
+ *    None
+ *
+ */
+void statsReset(sample_stats *stats)
+{
+  stats->count = 0;
+  stats->mean = 0;
+  stats->m2 = 0;
+}
+
+/**
+ * NAME: statsAdd()
+ * DESCRIPTION: Add a read to the window.
+ * PROCESS:   Replace the read by the median of the latest STATS_MEDIAN_SIZE reads (a single outlier never gets through)
+ *            Update the minimum, maximum, and last value
+ *            Update the running mean and sum of squared differences with Welford's method (no read is kept)
+ *
+ * INPUTS:
+ *    stats   The metric statistics
+ *    read    The raw read
+ * OUTPUTS:
+ *    The filtered read
+ *
+ */
+int16_t statsAdd(sample_stats *stats, int16_t read)
+{
+  // Median of the latest reads (insertion sort of a copy, the filter is only a few reads long)
+  stats->recent[stats->recentNext] = read;
+  stats->recentNext = (stats->recentNext + 1) % STATS_MEDIAN_SIZE;
+  if(stats->recentCount < STATS_MEDIAN_SIZE)
+    ++stats->recentCount;
+  int16_t sorted[STATS_MEDIAN_SIZE];
+  for(uint8_t i = 0;i < stats->recentCount;++i)
+  {
+    uint8_t j = i;
+    for(;j > 0 && sorted[j - 1] > stats->recent[i];--j)
+      sorted[j] = sorted[j - 1];
+    sorted[j] = stats->recent[i];
+  }
+  int16_t value = sorted[stats->recentCount / 2];
+
+  // Window statistics
+  if(stats->count == 0 || value < stats->min)
+    stats->min = value;
+  if(stats->count == 0 || value > stats->max)
+    stats->max = value;
+  stats->last = value;
+  ++stats->count;
+  float delta = value - stats->mean;
+  stats->mean += delta / stats->count;
+  stats->m2 += delta * (value - stats->mean);
+  return value;
+}
+
+/**
+ * NAME: statsMean()
+ * DESCRIPTION: Get the mean of the window.
+ *
+ * INPUTS:
+ *    stats   The metric statistics
+ * OUTPUTS:
+ *    The rounded mean (0 if the window is empty)
+ *
+ */
+int16_t statsMean(const sample_stats *stats)
+{
+  return (int16_t)lround(stats->mean);
+}
+
+/**
+ * NAME: statsStdDev()
+ * DESCRIPTION: Get the sample standard deviation of the window.
+ *
+ * INPUTS:
+ *    stats   The metric statistics
+ * OUTPUTS:
+ *    The rounded standard deviation (0 for fewer than 2 reads)
+ *
+ */
+int16_t statsStdDev(const sample_stats *stats)
+{
+  if(stats->count < 2)
+    return 0;
+  return (int16_t)lround(sqrt(stats->m2 / (stats->count - 1)));
+}
@@ -0,0 +1,40 @@
+/**
+ * NAME: SampleStats.h
+ * DESCRIPTION: Header file for the streaming statistics of the sensor reads taken between two samples (constant memory per metric).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef SampleStats_h
+#define SampleStats_h
+
+#include <Arduino.h>
+
+// Number of reads the median outlier filter looks at (odd, 1 disables the filter)
+#ifndef STATS_MEDIAN_SIZE
+#define STATS_MEDIAN_SIZE 3
+#endif
+
+typedef struct
+{
+  uint16_t count;                       // Filtered reads in the window
+  int16_t min;
+  int16_t max;
+  int16_t last;
+  float mean;                           // Running mean and sum of squared differences from the mean (Welford)
+  float m2;
+  int16_t recent[STATS_MEDIAN_SIZE];    // Latest raw reads for the median filter (kept across windows)
+  uint8_t recentCount;
+  uint8_t recentNext;
+} sample_stats;
+
+extern void statsBegin(sample_stats *stats);
+extern void statsReset(sample_stats *stats);
+extern int16_t statsAdd(sample_stats *stats, int16_t read);
+extern int16_t statsMean(const sample_stats *stats);
+extern int16_t statsStdDev(const sample_stats *stats);
+
+#endif
@@ -0,0 +1,99 @@
+#include "Scheduler.h"
+
+static volatile uint32_t ticks = 0;
+
+/**
+ * NAME: schedulerTick()
+ * DESCRIPTION: Advance the scheduler time base, called from the RTC PIT Interrupt Service Routine.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void schedulerTick()
+{
+  ++ticks;
+}
+
+/**
+ * NAME: schedulerTicks()
+ * DESCRIPTION: Get the number of scheduler ticks since the RTC was started.
+ * 
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Current tick count
+ *    
+ */
+uint32_t schedulerTicks()
+{
+  noInterrupts();
+  uint32_t now = ticks;
+  interrupts();
+  return now;
+}
+
+/**
+ * NAME: schedulerStart()
+ * DESCRIPTION: Make every periodic task due on the next pass of the scheduler.
+ * 
+ * INPUTS:
+ *    tasks   The task table
+ *    count   Number of tasks in the table
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void schedulerStart(scheduler_task *tasks, uint8_t count)
+{
+  uint32_t now = schedulerTicks();
+  for(uint8_t i = 0;i < count;++i)
+  {
+    tasks[i].due = now;
+    tasks[i].runs = 0;
+    tasks[i].missed = 0;
+  }
+}
+
+/**
+ * NAME: schedulerRun()
+ * DESCRIPTION: Run one pass of the cooperative scheduler, called from loop().
+ * PROCESS:   Run every state machine step task
+ *            Run every periodic task that is due and schedule its next run one period after the previous due time so the cadence does not drift
+ *            If a periodic task is late by more than its deadline count it as missed and skip any whole periods that were missed
+ * 
+ * INPUTS:
+ *    tasks   The task table
+ *    count   Number of tasks in the table
+ * OUTPUTS:
+ *    None
+ *    
+ */
+void schedulerRun(scheduler_task *tasks, uint8_t count)
+{
+  for(uint8_t i = 0;i < count;++i)
+  {
+    scheduler_task *task = &tasks[i];
+    if(task->period == 0)
+    {
+      task->run();
+      continue;
+    }
+
+    uint32_t late = schedulerTicks() - task->due;
+    if((int32_t)late < 0)
+      continue;
+    if(late > task->deadline)
+      ++task->missed;
+    if(late >= task->period)
+    {
+      task->missed += late / task->period;
+      task->due += (late / task->period) * task->period;
+    }
+    task->due += task->period;
+    ++task->runs;
+    task->run();
+  }
+}
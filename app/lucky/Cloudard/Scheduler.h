@@ -0,0 +1,37 @@
+/**
+ * NAME: Scheduler.h
+ * DESCRIPTION: Header file for the cooperative task scheduler driven by the RTC Periodic Interrupt Timer.
+ * 
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ * 
+ */
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <Arduino.h>
+
+// Scheduler tick rate, the RTC PIT runs at 32768 / SCHEDULER_TICK_HZ cycles
+#define SCHEDULER_TICK_HZ 8
+#define SECONDS_TO_TICKS(s) ((uint32_t)(s) * SCHEDULER_TICK_HZ)
+
+typedef void (*task_function)();
+
+typedef struct
+{
+  task_function run;
+  uint32_t period;      // Ticks between runs (0 = state machine step that runs on every pass)
+  uint32_t deadline;    // Ticks a periodic run may start late before it is counted as missed
+  uint32_t due;         // Tick of the next periodic run
+  uint16_t runs;
+  uint16_t missed;      // Periodic runs that were skipped or started after their deadline
+} scheduler_task;
+
+extern void schedulerTick();
+extern uint32_t schedulerTicks();
+extern void schedulerStart(scheduler_task *tasks, uint8_t count);
+extern void schedulerRun(scheduler_task *tasks, uint8_t count);
+
+#endif
@@ -0,0 +1,245 @@
+#include "BME280Model.h"
+
+/*!
+ *  @brief  Create a powered up BME280 with the example calibration of the datasheet and room condition ADC values
+ */
+BME280Model::BME280Model()
+{
+  memset(registers, 0, sizeof(registers));
+  reset();
+
+  // Temperature and pressure from the Bosch compensation example (25.08 C, 100653 Pa), humidity from a production part
+  bme280_calib_data calib;
+  calib.dig_T1 = 27504;
+  calib.dig_T2 = 26435;
+  calib.dig_T3 = -1000;
+  calib.dig_P1 = 36477;
+  calib.dig_P2 = -10685;
+  calib.dig_P3 = 3024;
+  calib.dig_P4 = 2855;
+  calib.dig_P5 = 140;
+  calib.dig_P6 = -7;
+  calib.dig_P7 = 15500;
+  calib.dig_P8 = -14600;
+  calib.dig_P9 = 6000;
+  calib.dig_H1 = 75;
+  calib.dig_H2 = 362;
+  calib.dig_H3 = 0;
+  calib.dig_H4 = 313;
+  calib.dig_H5 = 50;
+  calib.dig_H6 = 30;
+  setCalibration(calib);
+  setADC(519888, 415148, 30000);
+  conversionCount = 0;
+}
+
+/*!
+ *  @brief  Power on reset, the calibration and the injected ADC values are kept
+ */
+void BME280Model::reset()
+{
+  uint8_t calibration[0xA2 - 0x88];
+  uint8_t humidity[0xE8 - 0xE1];
+  memcpy(calibration, &registers[0x88], sizeof(calibration));
+  memcpy(humidity, &registers[0xE1], sizeof(humidity));
+
+  memset(registers, 0, sizeof(registers));
+  memcpy(&registers[0x88], calibration, sizeof(calibration));
+  memcpy(&registers[0xE1], humidity, sizeof(humidity));
+  registers[BME280_REGISTER_CHIPID] = BME280_CHIPID;
+  registers[BME280_REGISTER_PRESSUREDATA] = 0x80;
+  registers[BME280_REGISTER_TEMPDATA] = 0x80;
+  registers[BME280_REGISTER_HUMIDDATA] = 0x80;
+  pointer = 0;
+  osrsH = 0;
+  measuring = false;
+  stuck = false;
+}
+
+/*!
+ *  @brief  Store calibration data in the calibration registers (DS 5.4.2, H4 and H5 share 0xE5)
+ *  @param  calib the calibration data
+ */
+void BME280Model::setCalibration(const bme280_calib_data &calib)
+{
+  const uint16_t tp[12] = { calib.dig_T1, (uint16_t)calib.dig_T2, (uint16_t)calib.dig_T3,
+                            calib.dig_P1, (uint16_t)calib.dig_P2, (uint16_t)calib.dig_P3, (uint16_t)calib.dig_P4, (uint16_t)calib.dig_P5,
+                            (uint16_t)calib.dig_P6, (uint16_t)calib.dig_P7, (uint16_t)calib.dig_P8, (uint16_t)calib.dig_P9 };
+  for(uint8_t i = 0;i < 12;++i)
+  {
+    registers[BME280_REGISTER_DIG_T1 + 2 * i] = tp[i] & 0xFF;
+    registers[BME280_REGISTER_DIG_T1 + 2 * i + 1] = tp[i] >> 8;
+  }
+  registers[BME280_REGISTER_DIG_H1] = calib.dig_H1;
+  registers[BME280_REGISTER_DIG_H2] = calib.dig_H2 & 0xFF;
+  registers[BME280_REGISTER_DIG_H2 + 1] = (uint16_t)calib.dig_H2 >> 8;
+  registers[BME280_REGISTER_DIG_H3] = calib.dig_H3;
+  registers[BME280_REGISTER_DIG_H4] = (calib.dig_H4 >> 4) & 0xFF;
+  registers[BME280_REGISTER_DIG_H5] = (calib.dig_H4 & 0x0F) | ((calib.dig_H5 & 0x0F) << 4);
+  registers[BME280_REGISTER_DIG_H5 + 1] = (calib.dig_H5 >> 4) & 0xFF;
+  registers[BME280_REGISTER_DIG_H6] = (uint8_t)calib.dig_H6;
+}
+
+/*!
+ *  @brief  Set the raw ADC values the next conversion returns
+ *  @param  adc_T 20 bit temperature
+ *  @param  adc_P 20 bit pressure
+ *  @param  adc_H 16 bit humidity
+ */
+void BME280Model::setADC(int32_t adc_T, int32_t adc_P, int32_t adc_H)
+{
+  adcT = adc_T;
+  adcP = adc_P;
+  adcH = adc_H;
+}
+
+/*!
+ *  @brief  Make conversions never finish (the measuring bit stays set) to test the driver timeout
+ *  @param  stuck true to never finish
+ */
+void BME280Model::setStuck(bool stuck)
+{
+  this->stuck = stuck;
+}
+
+/*!
+ *  @brief  Get the current mode
+ *  @return BME280_MODE_SLEEP, BME280_MODE_FORCED (while converting), or BME280_MODE_NORMAL
+ */
+uint8_t BME280Model::mode()
+{
+  update();
+  uint8_t mode = registers[BME280_REGISTER_CONTROL] & 0x03;
+  return mode == 0x02 ? (uint8_t)BME280_MODE_FORCED : mode;
+}
+
+/*!
+ *  @brief  Get the number of conversions finished since power up
+ *  @return Number of conversions
+ */
+uint32_t BME280Model::conversions()
+{
+  return conversionCount;
+}
+
+/*!
+ *  @brief  Typical measurement time for the oversampling in ctrl_meas and ctrl_hum (DS 9.1)
+ *  @return Time in microseconds
+ */
+uint32_t BME280Model::conversionTimeUs()
+{
+  static const uint8_t samples[] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+  uint8_t t = samples[registers[BME280_REGISTER_CONTROL] >> 5];
+  uint8_t p = samples[(registers[BME280_REGISTER_CONTROL] >> 2) & 0x07];
+  uint8_t h = samples[osrsH];
+  return 1000 + 2000UL * t + (p ? 2000UL * p + 500 : 0) + (h ? 2000UL * h + 500 : 0);
+}
+
+/*!
+ *  @brief  Copy the injected ADC values to the data registers of the enabled measurements
+ */
+void BME280Model::latchResults()
+{
+  int32_t t = (registers[BME280_REGISTER_CONTROL] >> 5) ? adcT : BME280_MODEL_SKIPPED_TP;
+  int32_t p = ((registers[BME280_REGISTER_CONTROL] >> 2) & 0x07) ? adcP : BME280_MODEL_SKIPPED_TP;
+  int32_t h = osrsH ? adcH : BME280_MODEL_SKIPPED_H;
+  registers[BME280_REGISTER_PRESSUREDATA] = p >> 12;
+  registers[BME280_REGISTER_PRESSUREDATA + 1] = (p >> 4) & 0xFF;
+  registers[BME280_REGISTER_PRESSUREDATA + 2] = (p & 0x0F) << 4;
+  registers[BME280_REGISTER_TEMPDATA] = t >> 12;
+  registers[BME280_REGISTER_TEMPDATA + 1] = (t >> 4) & 0xFF;
+  registers[BME280_REGISTER_TEMPDATA + 2] = (t & 0x0F) << 4;
+  registers[BME280_REGISTER_HUMIDDATA] = h >> 8;
+  registers[BME280_REGISTER_HUMIDDATA + 1] = h & 0xFF;
+  ++conversionCount;
+}
+
+/*!
+ *  @brief  Finish a forced conversion once its time is up (the device goes back to sleep mode), in normal mode the data
+ *          registers always hold the injected values
+ */
+void BME280Model::update()
+{
+  if((registers[BME280_REGISTER_CONTROL] & 0x03) == BME280_MODE_NORMAL)
+    latchResults();
+  else if(measuring && !stuck && (long)(micros() - conversionEnd) >= 0)
+  {
+    measuring = false;
+    latchResults();
+    registers[BME280_REGISTER_CONTROL] &= ~0x03;
+  }
+}
+
+/*!
+ *  @brief  Write a register
+ *  @param  reg the register
+ *  @param  value the value
+ */
+void BME280Model::writeRegister(uint8_t reg, uint8_t value)
+{
+  switch(reg)
+  {
+    case BME280_REGISTER_SOFTRESET:
+      if(value == 0xB6)
+        reset();
+      break;
+    case BME280_REGISTER_CONTROLHUMID:
+      registers[reg] = value & 0x07;
+      break;
+    case BME280_REGISTER_CONFIG:
+      registers[reg] = value & 0xFD;
+      break;
+    case BME280_REGISTER_CONTROL:
+      registers[reg] = value;
+      osrsH = registers[BME280_REGISTER_CONTROLHUMID];
+      if((value & 0x03) == 0x01 || (value & 0x03) == 0x02)
+      {
+        measuring = true;
+        conversionEnd = micros() + conversionTimeUs();
+      }
+      else
+      {
+        measuring = false;
+      }
+      break;
+    default:
+      break;   // Read only
+  }
+}
+
+/*!
+ *  @brief  Write transaction: register address, then value and register address pairs
+ *  @param  data the bytes after the address byte
+ *  @param  length number of bytes
+ */
+void BME280Model::write(const uint8_t *data, uint8_t length)
+{
+  update();
+  if(length == 0)
+    return;
+  pointer = data[0];
+  for(uint8_t i = 1;i + 1 <= length;i += 2)
+  {
+    writeRegister(pointer, data[i]);
+    if(i + 1 < length)
+      pointer = data[i + 1];
+  }
+}
+
+/*!
+ *  @brief  Read transaction from the register address of the last write, auto incrementing
+ *  @param  data the bytes read
+ *  @param  length number of bytes
+ */
+void BME280Model::read(uint8_t *data, uint8_t length)
+{
+  update();
+  for(uint8_t i = 0;i < length;++i)
+  {
+    if(pointer == BME280_REGISTER_STATUS)
+      data[i] = measuring ? 0x08 : 0x00;
+    else
+      data[i] = registers[pointer];
+    ++pointer;
+  }
+}
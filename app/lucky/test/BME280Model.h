@@ -0,0 +1,57 @@
+/**
+ * NAME: BME280Model.h
+ * DESCRIPTION: Header file for the register level model of the BME280 on the simulated I2C bus: chip ID, calibration data,
+ *              sleep/forced/normal mode, forced conversions that take the datasheet typical measurement time, and ADC values
+ *              injected by the test.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef BME280Model_h
+#define BME280Model_h
+
+#include "I2CBus.h"
+#include "BME280.h"
+
+// Data registers hold these until a measurement is enabled (DS 5.4.7 to 5.4.9)
+#define BME280_MODEL_SKIPPED_TP 0x80000
+#define BME280_MODEL_SKIPPED_H 0x8000
+
+/*!
+ *  @brief  BME280 registers (reads auto increment, writes are register and value pairs, DS 6.2)
+ */
+class BME280Model : public I2CDevice
+{
+  public:
+    BME280Model();
+    void reset();
+    void setCalibration(const bme280_calib_data &calib);
+    void setADC(int32_t adc_T, int32_t adc_P, int32_t adc_H);
+    void setStuck(bool stuck);
+    uint8_t mode();
+    uint32_t conversions();
+    void write(const uint8_t *data, uint8_t length);
+    void read(uint8_t *data, uint8_t length);
+
+  private:
+    uint8_t registers[256];
+    uint8_t pointer;
+    uint8_t osrsH;                  // ctrl_hum only takes effect when ctrl_meas is written (DS 5.4.3)
+    int32_t adcT;
+    int32_t adcP;
+    int32_t adcH;
+    bool measuring;
+    bool stuck;                     // A conversion that never finishes
+    unsigned long conversionEnd;    // micros() when the conversion finishes
+    uint32_t conversionCount;
+
+    void writeRegister(uint8_t reg, uint8_t value);
+    void update();
+    void latchResults();
+    uint32_t conversionTimeUs();
+};
+
+#endif
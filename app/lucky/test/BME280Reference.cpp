@@ -0,0 +1,61 @@
+/**
+ * NAME: BME280Reference.cpp
+ * DESCRIPTION: The sketch BME280 driver compiled as class BME280Reference with BME280_PRESSURE_32BIT=0 (see BME280Reference.h).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#undef BME280_PRESSURE_32BIT
+#define BME280_PRESSURE_32BIT 0
+#define BME280 BME280Reference
+#define bme280 bme280Reference
+#include "BME280.cpp"
+#include "BME280Reference.h"
+
+/**
+ * NAME: referenceBegin()
+ * DESCRIPTION: Start the 64-bit driver (reads the calibration data from the simulated sensor).
+ *
+ * INPUTS:
+ *    address   I2C address of the sensor
+ * OUTPUTS:
+ *    True if the sensor was found
+ *
+ */
+bool referenceBegin(uint8_t address)
+{
+  return bme280Reference.begin(address);
+}
+
+/**
+ * NAME: referenceSetProfile()
+ * DESCRIPTION: Set the sampling profile of the 64-bit driver.
+ *
+ * INPUTS:
+ *    profile   The profile
+ * OUTPUTS:
+ *    None
+ *
+ */
+void referenceSetProfile(bme280_profile profile)
+{
+  bme280Reference.setProfile(profile);
+}
+
+/**
+ * NAME: referenceReadAllFixed()
+ * DESCRIPTION: Take a full sensor read with the 64-bit driver.
+ *
+ * INPUTS:
+ *    sample    The sample to fill in
+ * OUTPUTS:
+ *    True if the read succeeded
+ *
+ */
+bool referenceReadAllFixed(bme280_sample_fixed &sample)
+{
+  return bme280Reference.readAllFixed(sample);
+}
@@ -0,0 +1,21 @@
+/**
+ * NAME: BME280Reference.h
+ * DESCRIPTION: Header file for the sketch BME280 driver built a second time with the 64-bit pressure compensation, so the pressure
+ *              sweep can compare it with the 32-bit compensation of the firmware in one binary.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef BME280Reference_h
+#define BME280Reference_h
+
+#include "BME280.h"
+
+extern bool referenceBegin(uint8_t address);
+extern void referenceSetProfile(bme280_profile profile);
+extern bool referenceReadAllFixed(bme280_sample_fixed &sample);
+
+#endif
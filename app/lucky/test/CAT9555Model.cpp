@@ -0,0 +1,121 @@
+#include "CAT9555Model.h"
+
+/*!
+ *  @brief  Create a powered up CAT9555 with every input pulled up
+ */
+CAT9555Model::CAT9555Model()
+{
+  levels = 0xFFFF;
+  reset();
+}
+
+/*!
+ *  @brief  Power on reset (outputs high, no inversion, every pin an input)
+ */
+void CAT9555Model::reset()
+{
+  registers[OUTPUT_PORT0] = registers[OUTPUT_PORT1] = 0xFF;
+  registers[POLARITY_PORT0] = registers[POLARITY_PORT1] = 0x00;
+  registers[CONFIG_PORT0] = registers[CONFIG_PORT1] = 0xFF;
+  command = 0;
+  latched = pins();
+}
+
+/*!
+ *  @brief  Drive the pins configured as inputs
+ *  @param  levels the levels (port 0 in the high byte)
+ */
+void CAT9555Model::setInputs(uint16_t levels)
+{
+  this->levels = levels;
+}
+
+/*!
+ *  @brief  Get the output registers
+ *  @return Port 0 in the high byte
+ */
+uint16_t CAT9555Model::outputs()
+{
+  return (registers[OUTPUT_PORT0] << 8) | registers[OUTPUT_PORT1];
+}
+
+/*!
+ *  @brief  Get the configuration registers
+ *  @return Port 0 in the high byte (1 is an input)
+ */
+uint16_t CAT9555Model::config()
+{
+  return (registers[CONFIG_PORT0] << 8) | registers[CONFIG_PORT1];
+}
+
+/*!
+ *  @brief  Get the pin levels, the driven level for inputs and the output register for outputs
+ *  @return Port 0 in the high byte
+ */
+uint16_t CAT9555Model::pins()
+{
+  uint16_t inputs = config();
+  return (levels & inputs) | (outputs() & ~inputs);
+}
+
+/*!
+ *  @brief  Get the open drain INT output
+ *  @return True while asserted (an input changed since its port was last read)
+ */
+bool CAT9555Model::interrupt()
+{
+  return ((pins() ^ latched) & config()) != 0;
+}
+
+/*!
+ *  @brief  Read a register (reading an input port releases INT for that port)
+ *  @param  reg the register
+ *  @return The value
+ */
+uint8_t CAT9555Model::readRegister(uint8_t reg)
+{
+  uint16_t now = pins();
+  if(reg == INPUT_PORT0)
+  {
+    latched = (latched & 0x00FF) | (now & 0xFF00);
+    return (now >> 8) ^ registers[POLARITY_PORT0];
+  }
+  if(reg == INPUT_PORT1)
+  {
+    latched = (latched & 0xFF00) | (now & 0x00FF);
+    return (now & 0xFF) ^ registers[POLARITY_PORT1];
+  }
+  return registers[reg];
+}
+
+/*!
+ *  @brief  Write transaction: command byte, then data for the register pair
+ *  @param  data the bytes after the address byte
+ *  @param  length number of bytes
+ */
+void CAT9555Model::write(const uint8_t *data, uint8_t length)
+{
+  if(length == 0)
+    return;
+  command = data[0] & 0x07;
+  for(uint8_t i = 1;i < length;++i)
+  {
+    if(command >= OUTPUT_PORT0)
+      registers[command] = data[i];
+    command ^= 1;
+  }
+}
+
+/*!
+ *  @brief  Read transaction from the command byte of the last write
+ *  @param  data the bytes read
+ *  @param  length number of bytes
+ */
+void CAT9555Model::read(uint8_t *data, uint8_t length)
+{
+  for(uint8_t i = 0;i < length;++i)
+  {
+    data[i] = readRegister(command);
+    command ^= 1;
+  }
+}
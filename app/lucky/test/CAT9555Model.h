@@ -0,0 +1,44 @@
+/**
+ * NAME: CAT9555Model.h
+ * DESCRIPTION: Header file for the register level model of the CAT9555 16 bit I/O expander on the simulated I2C bus: input, output,
+ *              polarity inversion, and configuration register pairs, pin levels driven by the test, and the INT output.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef CAT9555Model_h
+#define CAT9555Model_h
+
+#include "I2CBus.h"
+#include "CAT9555.h"
+
+/*!
+ *  @brief  CAT9555 registers (reads and writes toggle between the two registers of a pair), 16 bit values have port 0 in the
+ *          high byte like the driver
+ */
+class CAT9555Model : public I2CDevice
+{
+  public:
+    CAT9555Model();
+    void reset();
+    void setInputs(uint16_t levels);
+    uint16_t outputs();
+    uint16_t pins();
+    uint16_t config();
+    bool interrupt();
+    void write(const uint8_t *data, uint8_t length);
+    void read(uint8_t *data, uint8_t length);
+
+  private:
+    uint8_t registers[8];
+    uint8_t command;
+    uint16_t levels;        // Levels driven on the pins configured as inputs
+    uint16_t latched;       // Input levels at the last read of each input port (INT is asserted while they differ)
+
+    uint8_t readRegister(uint8_t reg);
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "I2CBus.h"
+#include <Wire.h>
+
+I2CBus i2cBus;
+TwoWire Wire;
+
+/*!
+ *  @brief  Create an empty bus at the Wire default clock
+ */
+I2CBus::I2CBus() : clock(I2C_BUS_CLOCK_HZ)
+{
+  memset(devices, 0, sizeof(devices));
+  reset();
+}
+
+/*!
+ *  @brief  Put a device on the bus
+ *  @param  address the 7 bit address the device answers to
+ *  @param  device the device (NULL removes the device)
+ */
+void I2CBus::attach(uint8_t address, I2CDevice *device)
+{
+  devices[address & 0x7F] = device;
+}
+
+/*!
+ *  @brief  Set the bus clock used for the bus time
+ *  @param  clock the clock in Hz
+ */
+void I2CBus::setClock(uint32_t clock)
+{
+  this->clock = clock;
+}
+
+/*!
+ *  @brief  Count a transaction and move the clock forward by its bus time
+ *  @param  length number of bytes after the address byte
+ */
+void I2CBus::account(uint8_t length)
+{
+  uint32_t bits = 2 + 9UL * (1 + length);
+  uint32_t us = (bits * 1000000UL) / clock;
+  ++counters.transactions;
+  counters.bytes += 1 + length;
+  counters.busTimeUs += us;
+  hostAdvanceMicros(us);
+}
+
+/*!
+ *  @brief  Run a write transaction
+ *  @param  address the 7 bit address
+ *  @param  data the bytes after the address byte
+ *  @param  length number of bytes
+ *  @return I2C_BUS_OK, or I2C_BUS_ADDRESS_NACK if no device answers (only the address byte is sent)
+ */
+uint8_t I2CBus::write(uint8_t address, const uint8_t *data, uint8_t length)
+{
+  I2CDevice *device = devices[address & 0x7F];
+  if(device == NULL)
+  {
+    account(0);
+    return I2C_BUS_ADDRESS_NACK;
+  }
+  account(length);
+  device->write(data, length);
+  return I2C_BUS_OK;
+}
+
+/*!
+ *  @brief  Run a read transaction
+ *  @param  address the 7 bit address
+ *  @param  data the bytes read
+ *  @param  length number of bytes to read
+ *  @return Number of bytes read (0 if no device answers)
+ */
+uint8_t I2CBus::read(uint8_t address, uint8_t *data, uint8_t length)
+{
+  I2CDevice *device = devices[address & 0x7F];
+  if(device == NULL)
+  {
+    account(0);
+    return 0;
+  }
+  account(length);
+  device->read(data, length);
+  return length;
+}
+
+/*!
+ *  @brief  Clear the counters before measuring a driver call
+ */
+void I2CBus::reset()
+{
+  memset(&counters, 0, sizeof(counters));
+}
+
+/*!
+ *  @brief  Get the counters
+ *  @return The counters since the last reset
+ */
+const i2c_bus_stats &I2CBus::stats()
+{
+  return counters;
+}
+
+/*!
+ *  @brief  Create the Wire master
+ */
+TwoWire::TwoWire() : txAddress(0), txLength(0), rxLength(0), rxIndex(0) {}
+
+/*!
+ *  @brief  Join the bus as master
+ */
+void TwoWire::begin()
+{
+  txLength = 0;
+  rxLength = 0;
+  rxIndex = 0;
+}
+
+/*!
+ *  @brief  Set the bus clock
+ *  @param  clock the clock in Hz
+ */
+void TwoWire::setClock(uint32_t clock)
+{
+  i2cBus.setClock(clock);
+}
+
+/*!
+ *  @brief  Start buffering a write transaction
+ *  @param  address the 7 bit address
+ */
+void TwoWire::beginTransmission(uint8_t address)
+{
+  txAddress = address;
+  txLength = 0;
+}
+
+/*!
+ *  @brief  Add a byte to the write transaction
+ *  @param  data the byte
+ *  @return 1, or 0 if the buffer is full
+ */
+size_t TwoWire::write(uint8_t data)
+{
+  if(txLength >= BUFFER_LENGTH)
+    return 0;
+  txBuffer[txLength++] = data;
+  return 1;
+}
+
+/*!
+ *  @brief  Send the buffered write transaction
+ *  @param  sendStop ignored (every transaction ends with a STOP)
+ *  @return 0, or 2 if no device answers
+ */
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+  (void)sendStop;
+  uint8_t status = i2cBus.write(txAddress, txBuffer, txLength);
+  txLength = 0;
+  return status;
+}
+
+/*!
+ *  @brief  Run a read transaction into the receive buffer
+ *  @param  address the 7 bit address
+ *  @param  quantity number of bytes to read
+ *  @return Number of bytes read
+ */
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+  if(quantity > BUFFER_LENGTH)
+    quantity = BUFFER_LENGTH;
+  rxLength = i2cBus.read(address, rxBuffer, quantity);
+  rxIndex = 0;
+  return rxLength;
+}
+
+/*!
+ *  @brief  Get the number of received bytes not read yet
+ *  @return Number of bytes
+ */
+int TwoWire::available()
+{
+  return rxLength - rxIndex;
+}
+
+/*!
+ *  @brief  Get the next received byte
+ *  @return The byte, or -1 if there is none
+ */
+int TwoWire::read()
+{
+  return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1;
+}
@@ -0,0 +1,66 @@
+/**
+ * NAME: I2CBus.h
+ * DESCRIPTION: Header file for the simulated I2C bus behind the host Wire library, which hands each transaction to the register
+ *              model at its address and counts the transactions, bytes, and bus time of the traffic.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef I2CBus_h
+#define I2CBus_h
+
+#include <Arduino.h>
+
+// Wire default clock
+#define I2C_BUS_CLOCK_HZ 100000UL
+
+// Wire endTransmission() status
+#define I2C_BUS_OK 0
+#define I2C_BUS_ADDRESS_NACK 2
+
+typedef struct
+{
+  uint32_t transactions;    // START to STOP (a register read is a write and a read transaction)
+  uint32_t bytes;           // Bytes on the wire including the address bytes
+  uint32_t busTimeUs;       // Bus time at the bus clock, 9 bits a byte and 1 bit each for START and STOP
+} i2c_bus_stats;
+
+/*!
+ *  @brief  A device on the simulated bus (the bytes after the address byte of each transaction)
+ */
+class I2CDevice
+{
+  public:
+    virtual ~I2CDevice() {}
+    virtual void write(const uint8_t *data, uint8_t length) = 0;
+    virtual void read(uint8_t *data, uint8_t length) = 0;
+};
+
+/*!
+ *  @brief  The simulated bus, every transaction moves the simulated clock forward by its bus time
+ */
+class I2CBus
+{
+  public:
+    I2CBus();
+    void attach(uint8_t address, I2CDevice *device);
+    void setClock(uint32_t clock);
+    uint8_t write(uint8_t address, const uint8_t *data, uint8_t length);
+    uint8_t read(uint8_t address, uint8_t *data, uint8_t length);
+    void reset();
+    const i2c_bus_stats &stats();
+
+  private:
+    I2CDevice *devices[128];
+    uint32_t clock;
+    i2c_bus_stats counters;
+
+    void account(uint8_t length);
+};
+
+extern I2CBus i2cBus;
+
+#endif
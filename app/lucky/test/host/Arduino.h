@@ -0,0 +1,51 @@
+/**
+ * NAME: Arduino.h
+ * DESCRIPTION: Host stand-in for the parts of the Arduino core used by the Lucky Shield drivers, with a simulated clock that only
+ *              moves on delay() and on simulated I2C bus time so every run is repeatable.
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+
+#define digitalPinToInterrupt(pin) (pin)
+#define interrupts()
+#define noInterrupts()
+
+extern unsigned long millis();
+extern unsigned long micros();
+extern void delay(unsigned long ms);
+extern void delayMicroseconds(unsigned int us);
+extern void pinMode(uint8_t pin, uint8_t mode);
+extern int digitalRead(uint8_t pin);
+extern void digitalWrite(uint8_t pin, uint8_t value);
+extern void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode);
+
+// Host only: move the simulated clock forward and set the level of a pin
+extern void hostAdvanceMicros(unsigned long us);
+extern void hostSetPin(uint8_t pin, int level);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * NAME: EEPROM.h
+ * DESCRIPTION: Host stand-in for the Arduino EEPROM library (1 KB erased to 0xFF, the ATmega328P size).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <Arduino.h>
+
+#define HOST_EEPROM_SIZE 1024
+
+/*!
+ *  @brief  EEPROM held in RAM, counts the cells that were actually written
+ */
+class EEPROMClass
+{
+  public:
+    EEPROMClass() { erase(); }
+
+    uint8_t read(int address) { return cells[address]; }
+    void write(int address, uint8_t value) { cells[address] = value; ++writes; }
+    void update(int address, uint8_t value) { if(cells[address] != value) write(address, value); }
+    uint16_t length() { return HOST_EEPROM_SIZE; }
+
+    template <typename T> T &get(int address, T &value)
+    {
+      memcpy(&value, &cells[address], sizeof(T));
+      return value;
+    }
+
+    template <typename T> const T &put(int address, const T &value)
+    {
+      const uint8_t *p = (const uint8_t *)&value;
+      for(size_t i = 0;i < sizeof(T);++i)
+        update(address + i, p[i]);
+      return value;
+    }
+
+    // Host only: erase every cell and clear the write counter
+    void erase()
+    {
+      memset(cells, 0xFF, sizeof(cells));
+      writes = 0;
+    }
+
+    uint32_t writes;
+
+  private:
+    uint8_t cells[HOST_EEPROM_SIZE];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,168 @@
+#include <Arduino.h>
+#include <EEPROM.h>
+
+#define HOST_PINS 32
+
+EEPROMClass EEPROM;
+
+static unsigned long long nowMicros = 0;
+static int pinLevels[HOST_PINS];
+
+/**
+ * NAME: millis()
+ * DESCRIPTION: Get the simulated time.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Milliseconds since the start of the run
+ *
+ */
+unsigned long millis()
+{
+  return (unsigned long)(nowMicros / 1000);
+}
+
+/**
+ * NAME: micros()
+ * DESCRIPTION: Get the simulated time.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    Microseconds since the start of the run
+ *
+ */
+unsigned long micros()
+{
+  return (unsigned long)nowMicros;
+}
+
+/**
+ * NAME: delay()
+ * DESCRIPTION: Move the simulated clock forward instead of waiting.
+ *
+ * INPUTS:
+ *    ms    The delay in milliseconds
+ * OUTPUTS:
+ *    None
+ *
+ */
+void delay(unsigned long ms)
+{
+  nowMicros += ms * 1000ULL;
+}
+
+/**
+ * NAME: delayMicroseconds()
+ * DESCRIPTION: Move the simulated clock forward instead of waiting.
+ *
+ * INPUTS:
+ *    us    The delay in microseconds
+ * OUTPUTS:
+ *    None
+ *
+ */
+void delayMicroseconds(unsigned int us)
+{
+  nowMicros += us;
+}
+
+/**
+ * NAME: hostAdvanceMicros()
+ * DESCRIPTION: Move the simulated clock forward (the I2C bus adds the time of every transaction).
+ *
+ * INPUTS:
+ *    us    The time in microseconds
+ * OUTPUTS:
+ *    None
+ *
+ */
+void hostAdvanceMicros(unsigned long us)
+{
+  nowMicros += us;
+}
+
+/**
+ * NAME: pinMode()
+ * DESCRIPTION: Set the mode of a pin (an input with a pull-up reads HIGH until the test drives it).
+ *
+ * INPUTS:
+ *    pin     The pin
+ *    mode    INPUT, OUTPUT, or INPUT_PULLUP
+ * OUTPUTS:
+ *    None
+ *
+ */
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if(pin < HOST_PINS && mode == INPUT_PULLUP)
+    pinLevels[pin] = HIGH;
+}
+
+/**
+ * NAME: digitalRead()
+ * DESCRIPTION: Read the level of a pin.
+ *
+ * INPUTS:
+ *    pin   The pin
+ * OUTPUTS:
+ *    HIGH or LOW
+ *
+ */
+int digitalRead(uint8_t pin)
+{
+  return pin < HOST_PINS ? pinLevels[pin] : LOW;
+}
+
+/**
+ * NAME: digitalWrite()
+ * DESCRIPTION: Set the level of an output pin.
+ *
+ * INPUTS:
+ *    pin     The pin
+ *    value   HIGH or LOW
+ * OUTPUTS:
+ *    None
+ *
+ */
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  hostSetPin(pin, value);
+}
+
+/**
+ * NAME: hostSetPin()
+ * DESCRIPTION: Drive a pin from the test.
+ *
+ * INPUTS:
+ *    pin     The pin
+ *    level   HIGH or LOW
+ * OUTPUTS:
+ *    None
+ *
+ */
+void hostSetPin(uint8_t pin, int level)
+{
+  if(pin < HOST_PINS)
+    pinLevels[pin] = level;
+}
+
+/**
+ * NAME: attachInterrupt()
+ * DESCRIPTION: Accept an interrupt handler (pin interrupts are not simulated).
+ *
+ * INPUTS:
+ *    interrupt   The interrupt number
+ *    handler     The handler
+ *    mode        CHANGE, FALLING, or RISING
+ * OUTPUTS:
+ *    None
+ *
+ */
+void attachInterrupt(uint8_t interrupt, void (*handler)(), int mode)
+{
+  (void)interrupt;
+  (void)handler;
+  (void)mode;
+}
@@ -0,0 +1,46 @@
+/**
+ * NAME: Wire.h
+ * DESCRIPTION: Host stand-in for the Arduino Wire library that runs every transaction on the simulated I2C bus (see I2CBus.h).
+ *              Like the AVR library a write is buffered until endTransmission() and a read is done in full by requestFrom().
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include <Arduino.h>
+
+#define BUFFER_LENGTH 32
+
+/*!
+ *  @brief  I2C master on the simulated bus
+ */
+class TwoWire
+{
+  public:
+    TwoWire();
+    void begin();
+    void setClock(uint32_t clock);
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available();
+    int read();
+
+  private:
+    uint8_t txAddress;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    uint8_t txLength;
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    uint8_t rxLength;
+    uint8_t rxIndex;
+};
+
+extern TwoWire Wire;
+
+#endif
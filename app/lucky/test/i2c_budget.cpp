@@ -0,0 +1,268 @@
+/**
+ * NAME: i2c_budget.cpp
+ * DESCRIPTION: Host test of the Lucky Shield drivers on the simulated I2C bus. Runs lucky.begin(), displayLED(), and a full sensor
+ *              read against the BME280 and CAT9555 models, checks the results, and fails if a call uses more transactions, bytes,
+ *              or bus time than its budget (the budgets are the current cost, lower them when a change saves bus traffic).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <EEPROM.h>
+#include "I2CBus.h"
+#include "BME280Model.h"
+#include "CAT9555Model.h"
+#include "Lucky.h"
+#include "LedDisplay.h"
+#include "I2CStats.h"
+
+// Address of the calibration cache (EEPROM_CALIBRATION_ADDRESS in EepromLayout.h)
+#define CALIBRATION_CACHE_ADDRESS 0
+
+// Largest difference from the double precision compensation in Pa (the truncations of the 32-bit formula cost a few Pa)
+#if BME280_PRESSURE_32BIT
+#define PRESSURE_TOLERANCE 4.0
+#else
+#define PRESSURE_TOLERANCE 1.0
+#endif
+
+typedef struct
+{
+  uint32_t transactions;
+  uint32_t bytes;
+  uint32_t busTimeUs;
+} i2c_budget;
+
+// Chip ID read, both calibration bursts, 4 sampling writes, and the CAT9555 direction and output writes
+static const i2c_budget BEGIN_COLD_BUDGET = { 13, 65, 6110 };
+// Same with the calibration taken from the EEPROM cache
+static const i2c_budget BEGIN_WARM_BUDGET = { 9, 26, 2520 };
+// 4 sampling writes
+static const i2c_budget SET_PROFILE_BUDGET = { 4, 12, 1160 };
+// At most one output port write (nothing when the LEDs do not change)
+static const i2c_budget DISPLAY_LED_BUDGET = { 1, 3, 290 };
+// Forced mode trigger, status polls until the 8 ms typical conversion is done (1 ms apart), and the 8 byte data burst
+static const i2c_budget READ_ALL_FIXED_BUDGET = { 17, 42, 4120 };
+
+Lucky lucky;
+static BME280Model bmeModel;
+static CAT9555Model catModel;
+static int failures = 0;
+
+/**
+ * NAME: check()
+ * DESCRIPTION: Report a failed check.
+ *
+ * INPUTS:
+ *    ok          Result of the check
+ *    condition   Text of the check
+ *    line        Source line of the check
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void check(bool ok, const char *condition, int line)
+{
+  if(!ok)
+  {
+    printf("FAILED line %d: %s\n", line, condition);
+    ++failures;
+  }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/**
+ * NAME: startMeasure()
+ * DESCRIPTION: Clear the bus counters and the driver counters before a driver call.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void startMeasure()
+{
+  i2cBus.reset();
+  i2cStatsReset();
+}
+
+/**
+ * NAME: checkBudget()
+ * DESCRIPTION: Print the I2C traffic of a driver call and check it against its budget and against the driver's own accounting.
+ *
+ * INPUTS:
+ *    name      Name of the driver call
+ *    budget    The budget
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void checkBudget(const char *name, const i2c_budget &budget)
+{
+  const i2c_bus_stats &used = i2cBus.stats();
+  printf("%-28s %4u/%-4u transactions %5u/%-5u bytes %6u/%-6u us\n", name,
+         (unsigned)used.transactions, (unsigned)budget.transactions, (unsigned)used.bytes, (unsigned)budget.bytes,
+         (unsigned)used.busTimeUs, (unsigned)budget.busTimeUs);
+  CHECK(used.transactions <= budget.transactions);
+  CHECK(used.bytes <= budget.bytes);
+  CHECK(used.busTimeUs <= budget.busTimeUs);
+
+  // I2CStats counts a register read as one access where the bus sees a write and a read transaction
+  CHECK(i2cStats.bytes == used.bytes);
+  CHECK(i2cStats.busTimeUs == used.busTimeUs);
+  CHECK(i2cStats.transactions <= used.transactions);
+}
+
+/**
+ * NAME: referenceSample()
+ * DESCRIPTION: Compensate raw ADC values with the double precision formulas of the datasheet (DS 8.1) as the expected result.
+ *
+ * INPUTS:
+ *    calib     The calibration data
+ *    adc_T     Raw temperature
+ *    adc_P     Raw pressure
+ *    adc_H     Raw humidity
+ * OUTPUTS:
+ *    Temperature in degrees C, pressure in Pa, and humidity in %RH
+ *
+ */
+static bme280_sample referenceSample(const bme280_calib_data &calib, int32_t adc_T, int32_t adc_P, int32_t adc_H)
+{
+  bme280_sample sample;
+  double var1 = (adc_T / 16384.0 - calib.dig_T1 / 1024.0) * calib.dig_T2;
+  double var2 = (adc_T / 131072.0 - calib.dig_T1 / 8192.0) * (adc_T / 131072.0 - calib.dig_T1 / 8192.0) * calib.dig_T3;
+  double tFine = var1 + var2;
+  sample.temperature = tFine / 5120.0;
+
+  var1 = tFine / 2.0 - 64000.0;
+  var2 = var1 * var1 * calib.dig_P6 / 32768.0;
+  var2 = var2 + var1 * calib.dig_P5 * 2.0;
+  var2 = var2 / 4.0 + calib.dig_P4 * 65536.0;
+  var1 = (calib.dig_P3 * var1 * var1 / 524288.0 + calib.dig_P2 * var1) / 524288.0;
+  var1 = (1.0 + var1 / 32768.0) * calib.dig_P1;
+  double p = 1048576.0 - adc_P;
+  p = (p - var2 / 4096.0) * 6250.0 / var1;
+  var1 = calib.dig_P9 * p * p / 2147483648.0;
+  var2 = p * calib.dig_P8 / 32768.0;
+  sample.pressure = p + (var1 + var2 + calib.dig_P7) / 16.0;
+
+  double h = tFine - 76800.0;
+  h = (adc_H - (calib.dig_H4 * 64.0 + calib.dig_H5 / 16384.0 * h)) *
+      (calib.dig_H2 / 65536.0 * (1.0 + calib.dig_H6 / 67108864.0 * h * (1.0 + calib.dig_H3 / 67108864.0 * h)));
+  h = h * (1.0 - calib.dig_H1 * h / 524288.0);
+  sample.humidity = h < 0 ? 0 : (h > 100 ? 100 : h);
+  return sample;
+}
+
+/**
+ * NAME: checkSample()
+ * DESCRIPTION: Inject raw ADC values, take a full sensor read, and check it against the reference compensation.
+ *
+ * INPUTS:
+ *    calib     The calibration data in the model
+ *    adc_T     Raw temperature
+ *    adc_P     Raw pressure
+ *    adc_H     Raw humidity
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void checkSample(const bme280_calib_data &calib, int32_t adc_T, int32_t adc_P, int32_t adc_H)
+{
+  bmeModel.setADC(adc_T, adc_P, adc_H);
+  uint32_t conversions = bmeModel.conversions();
+  bme280_sample_fixed sample;
+  startMeasure();
+  CHECK(lucky.environment().readAllFixed(sample));
+  checkBudget("readAllFixed()", READ_ALL_FIXED_BUDGET);
+  CHECK(bmeModel.conversions() == conversions + 1);
+  CHECK(bmeModel.mode() == BME280_MODE_SLEEP);
+
+  bme280_sample expected = referenceSample(calib, adc_T, adc_P, adc_H);
+  printf("%-28s %.2f/%.2f C %u/%.0f Pa %.2f/%.2f %%RH\n", "  sample/reference", sample.temperature / 100.0, expected.temperature,
+         (unsigned)sample.pressure, expected.pressure, sample.humidity / 1024.0, expected.humidity);
+  CHECK(fabs(sample.temperature / 100.0 - expected.temperature) <= 0.01);
+  CHECK(fabs(sample.pressure - expected.pressure) <= PRESSURE_TOLERANCE);
+  CHECK(fabs(sample.humidity / 1024.0 - expected.humidity) <= 0.05);
+}
+
+/**
+ * NAME: main()
+ * DESCRIPTION: Run the driver calls of setup() and readTask() on the simulated bus.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    0 if every check passed
+ *
+ */
+int main()
+{
+  i2cBus.attach(BME280_ADDRESS, &bmeModel);
+  i2cBus.attach(ADDRESS, &catModel);
+
+  // First power up: the calibration is read from the sensor and cached in EEPROM
+  lucky.environment().setCalibrationCache(CALIBRATION_CACHE_ADDRESS);
+  startMeasure();
+  lucky.begin();
+  checkBudget("lucky.begin() cold", BEGIN_COLD_BUDGET);
+  CHECK(EEPROM.writes != 0);
+  CHECK(catModel.config() == 0x0E7F);
+  CHECK(catModel.outputs() == 0x3CFF);
+
+  // Next power up: the calibration comes from the cache
+  uint32_t eepromWrites = EEPROM.writes;
+  bmeModel.reset();
+  catModel.reset();
+  startMeasure();
+  lucky.begin();
+  checkBudget("lucky.begin() warm", BEGIN_WARM_BUDGET);
+  CHECK(EEPROM.writes == eepromWrites);
+
+  startMeasure();
+  lucky.environment().setProfile(BME280_PROFILE_WEATHER_MONITORING);
+  checkBudget("setProfile()", SET_PROFILE_BUDGET);
+  CHECK(bmeModel.mode() == BME280_MODE_SLEEP);
+
+  // LED1 and LED2 are lit by driving the pin LOW
+  static const int values[] = { 0, 1, 2, 3, 3, 0 };
+  for(size_t i = 0;i < sizeof(values) / sizeof(values[0]);++i)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "displayLED(%d)", values[i]);
+    startMeasure();
+    displayLED(values[i]);
+    checkBudget(name, DISPLAY_LED_BUDGET);
+    CHECK(((catModel.pins() & LED1) == 0) == ((values[i] & 0x01) != 0));
+    CHECK(((catModel.pins() & LED2) == 0) == ((values[i] & 0x02) != 0));
+    CHECK((catModel.outputs() & ~(LED1 | LED2)) == (0x3CFF & ~(LED1 | LED2)));
+  }
+
+  // Full sensor reads with the Bosch example values and a second set that must not return the first result
+  bme280_calib_data calib = { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000, 75, 362, 0, 313, 50, 30 };
+  checkSample(calib, 519888, 415148, 30000);
+  checkSample(calib, 530000, 400000, 25000);
+
+  // A conversion that never finishes fails the read and leaves the sample alone
+  bmeModel.setStuck(true);
+  bme280_sample_fixed sample = { 1, 2, 3 };
+  unsigned long start = millis();
+  CHECK(!lucky.environment().readAllFixed(sample));
+  CHECK(sample.temperature == 1 && sample.pressure == 2 && sample.humidity == 3);
+  CHECK(millis() - start <= 2UL * lucky.environment().measurementTime() + 2);
+  bmeModel.setStuck(false);
+
+  if(failures != 0)
+  {
+    printf("%d checks FAILED\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("All checks passed\n");
+  return EXIT_SUCCESS;
+}
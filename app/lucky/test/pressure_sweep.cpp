@@ -0,0 +1,137 @@
+/**
+ * NAME: pressure_sweep.cpp
+ * DESCRIPTION: Host test of the BME280 pressure compensation. Sweeps raw temperature and pressure ADC values through the simulated
+ *              sensor, reads each one with the 32-bit compensation of the firmware and with the 64-bit compensation, and fails if
+ *              the 32-bit result drifts further than PRESSURE_MAX_DEVIATION from the 64-bit one anywhere in the operating range
+ *              (the 32-bit formula overflows below about -49 degrees C, outside the range of the sensor).
+ *
+ * AUTHOR: Professor Mark Reha
+ * VERSION: 1.0.0   Initial release
+ * COPYRIGHT: On The Edge Software Consulting Services 2018.  All rights reserved.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "I2CBus.h"
+#include "BME280Model.h"
+#include "BME280Reference.h"
+
+#if !BME280_PRESSURE_32BIT
+#error "The pressure sweep compares the 32-bit compensation with the 64-bit one, build it with BME280_PRESSURE_32BIT=1"
+#endif
+
+// Largest difference in Pa allowed between the 32-bit and the 64-bit compensation (the truncations of the 32-bit formula cost up to 6 Pa)
+#define PRESSURE_MAX_DEVIATION 6
+
+// Operating range of the sensor (DS 1), readings outside it are not compared
+#define TEMPERATURE_MIN_C100 -4000
+#define TEMPERATURE_MAX_C100 8500
+#define PRESSURE_MIN_PA 30000
+#define PRESSURE_MAX_PA 110000
+
+// Raw temperatures from about -56 to 85 degrees C with the calibration below and the full 20-bit raw pressure range
+#define ADC_T_FIRST 0x40000
+#define ADC_T_LAST 0xB0000
+#define ADC_T_STEPS 256
+#define ADC_P_FIRST 0x00000
+#define ADC_P_LAST 0xFFFFF
+#define ADC_P_STEPS 1024
+
+static BME280Model bmeModel;
+static int failures = 0;
+
+/**
+ * NAME: check()
+ * DESCRIPTION: Count and print a failed check.
+ *
+ * INPUTS:
+ *    ok          Result of the check
+ *    condition   Text of the check
+ *    line        Source line of the check
+ * OUTPUTS:
+ *    None
+ *
+ */
+static void check(bool ok, const char *condition, int line)
+{
+  if(!ok)
+  {
+    printf("FAILED line %d: %s\n", line, condition);
+    ++failures;
+  }
+}
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+/**
+ * NAME: main()
+ * DESCRIPTION: Read every point of the sweep with both compensations and check the largest pressure deviation.
+ *
+ * INPUTS:
+ *    None
+ * OUTPUTS:
+ *    0 if every check passed
+ *
+ */
+int main()
+{
+  // Bosch example calibration (the same as the I2C budget test)
+  bme280_calib_data calib = { 27504, 26435, -1000, 36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000, 75, 362, 0, 313, 50, 30 };
+  bmeModel.setCalibration(calib);
+  i2cBus.attach(BME280_ADDRESS, &bmeModel);
+  CHECK(bme280.begin(BME280_ADDRESS));
+  bme280.setProfile(BME280_PROFILE_WEATHER_MONITORING);
+  CHECK(referenceBegin(BME280_ADDRESS));
+  referenceSetProfile(BME280_PROFILE_WEATHER_MONITORING);
+
+  uint32_t compared = 0;
+  uint32_t maxDeviation = 0;
+  int32_t worstT = 0;
+  int32_t worstP = 0;
+  for(int32_t t = 0;t < ADC_T_STEPS;++t)
+  {
+    int32_t adc_T = ADC_T_FIRST + (int32_t)((int64_t)(ADC_T_LAST - ADC_T_FIRST) * t / (ADC_T_STEPS - 1));
+    for(int32_t p = 0;p < ADC_P_STEPS;++p)
+    {
+      int32_t adc_P = ADC_P_FIRST + (int32_t)((int64_t)(ADC_P_LAST - ADC_P_FIRST) * p / (ADC_P_STEPS - 1));
+      if(adc_P == BME280_MODEL_SKIPPED_TP)
+        continue;
+      bmeModel.setADC(adc_T, adc_P, 30000);
+      bme280_sample_fixed sample;
+      bme280_sample_fixed reference;
+      if(!bme280.readAllFixed(sample) || !referenceReadAllFixed(reference))
+      {
+        CHECK(!"readAllFixed() failed");
+        continue;
+      }
+
+      // Only the pressure compensation differs
+      CHECK(sample.temperature == reference.temperature);
+      CHECK(sample.humidity == reference.humidity);
+      if(reference.temperature < TEMPERATURE_MIN_C100 || reference.temperature > TEMPERATURE_MAX_C100 ||
+         reference.pressure < PRESSURE_MIN_PA || reference.pressure > PRESSURE_MAX_PA)
+        continue;
+      uint32_t deviation = sample.pressure > reference.pressure ? sample.pressure - reference.pressure : reference.pressure - sample.pressure;
+      if(deviation > maxDeviation)
+      {
+        maxDeviation = deviation;
+        worstT = adc_T;
+        worstP = adc_P;
+      }
+      ++compared;
+    }
+  }
+  printf("%-28s %u readings compared, largest deviation %u/%u Pa at adc_T=0x%05X adc_P=0x%05X\n", "32-bit/64-bit pressure",
+         (unsigned)compared, (unsigned)maxDeviation, (unsigned)PRESSURE_MAX_DEVIATION, (unsigned)worstT, (unsigned)worstP);
+  CHECK(compared != 0);
+  CHECK(maxDeviation <= PRESSURE_MAX_DEVIATION);
+
+  if(failures != 0)
+  {
+    printf("%d checks FAILED\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("All checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""
+NAME: weather_server.py
+DESCRIPTION: Reference decoder for the Cloudard sensor payloads and a local stand-in for the REST API Save endpoints.
+
+Cloudard POSTs either JSON (Content-Type: application/json) or CBOR (Content-Type: application/cbor).
+The CBOR payload (schema version 1, see writePostCBOR() in Cloudard.ino) is:
+
+    [ 1, deviceID, [ [timestamp, temperature, pressure, humidity], ... ] ]
+
+timestamp is epoch seconds (0 if the device did not know the time) and the sensor values are integers in
+hundredths of a degree F, an inHg, and a %.
+
+Every METRICS_UPLOAD_POSTS POSTs the payload also carries the timing metrics (see Metrics.h): schema version 2 appends
+them to the CBOR array and the first JSON sample has a "metrics" member.
+
+    [ 2, deviceID, [ ... ], [ secs, read, encode, display, [ [success, redirect, clientError, serverError, timeouts, errors, connect, request], ... ] ] ]
+
+Every histogram (read, encode, ...) is [count, p50, p90, max] in milliseconds and the endpoints are in slot order.
+
+Usage: python3 weather_server.py [port]     (the default port 8080 matches the DEV_ENV endpoint)
+Only the Python standard library is used.
+"""
+
+import json
+import struct
+import sys
+from http.server import BaseHTTPRequestHandler, HTTPServer
+
+
+def cbor_decode(data):
+    """Decode a CBOR item (integers, strings, arrays, maps, simple values, floats) and return (item, bytes used)."""
+    def item(pos):
+        initial = data[pos]
+        major, info = initial >> 5, initial & 0x1F
+        pos += 1
+        if info < 24:
+            value = info
+        elif info in (24, 25, 26, 27):
+            size = 1 << (info - 24)
+            if major == 7 and size > 1:
+                value = struct.unpack(">" + {2: "e", 4: "f", 8: "d"}[size], data[pos:pos + size])[0]
+                return value, pos + size
+            value = int.from_bytes(data[pos:pos + size], "big")
+            pos += size
+        else:
+            raise ValueError("Indefinite lengths are not supported")
+        if major == 0:
+            return value, pos
+        if major == 1:
+            return -1 - value, pos
+        if major == 2:
+            return bytes(data[pos:pos + value]), pos + value
+        if major == 3:
+            return data[pos:pos + value].decode("utf-8"), pos + value
+        if major == 4:
+            items = []
+            for _ in range(value):
+                member, pos = item(pos)
+                items.append(member)
+            return items, pos
+        if major == 5:
+            pairs = {}
+            for _ in range(value):
+                key, pos = item(pos)
+                pairs[key], pos = item(pos)
+            return pairs, pos
+        if major == 6:
+            return item(pos)
+        return {20: False, 21: True, 22: None}.get(value), pos
+    return item(0)
+
+
+METRICS_ENDPOINT_FIELDS = ("success", "redirect", "clientError", "serverError", "timeouts", "errors", "connect", "request")
+
+
+def decode_cbor_metrics(metrics):
+    """Convert the CBOR timing metrics to the same dictionary as the JSON "metrics" member."""
+    secs, read, encode, display, endpoints = metrics
+    return {"secs": secs, "read": read, "encode": encode, "display": display,
+            "endpoints": [dict(zip(METRICS_ENDPOINT_FIELDS, endpoint)) for endpoint in endpoints]}
+
+
+def decode_cbor_samples(data):
+    """Convert a CBOR payload to the same list of sample dictionaries as the JSON payload."""
+    payload, used = cbor_decode(data)
+    if used != len(data):
+        raise ValueError("Trailing bytes after the CBOR payload")
+    version = payload[0]
+    if version == 1:
+        device_id, samples = payload[1:]
+        metrics = None
+    elif version == 2:
+        device_id, samples, metrics = payload[1:]
+    else:
+        raise ValueError("Unsupported CBOR schema version %d" % version)
+    decoded = []
+    for timestamp, temperature, pressure, humidity in samples:
+        sample = {"deviceID": device_id, "temperature": temperature / 100.0,
+                  "pressure": pressure / 100.0, "humidity": humidity / 100.0}
+        if timestamp:
+            sample["timestamp"] = timestamp
+        decoded.append(sample)
+    if metrics is not None and decoded:
+        decoded[0]["metrics"] = decode_cbor_metrics(metrics)
+    return decoded
+
+
+def decode_json_samples(data):
+    """Convert a JSON payload (a single object or an array of objects) to a list of sample dictionaries."""
+    payload = json.loads(data.decode("utf-8"))
+    return payload if isinstance(payload, list) else [payload]
+
+
+class WeatherHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        try:
+            if self.headers.get("Content-Type", "").startswith("application/cbor"):
+                samples = decode_cbor_samples(body)
+            else:
+                samples = decode_json_samples(body)
+            status = 200
+        except (ValueError, TypeError, IndexError) as error:
+            print("Bad payload on %s: %s" % (self.path, error))
+            samples, status = [], 400
+        for sample in samples:
+            print("%s %d bytes: %s" % (self.path, len(body), json.dumps(sample)))
+        reply = json.dumps({"status": status}).encode("utf-8")
+        self.send_response(status)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(reply)))
+        self.end_headers()
+        self.wfile.write(reply)
+
+    def log_message(self, format, *args):
+        pass
+
+
+if __name__ == "__main__":
+    port = int(sys.argv[1]) if len(sys.argv) > 1 else 8080
+    print("Listening for weather samples on port %d" % port)
+    HTTPServer(("", port), WeatherHandler).serve_forever()